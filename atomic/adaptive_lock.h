@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Adaptive spin-then-park lock, a drop-in Lockable (lock/try_lock/unlock) for
+ * std::lock_guard and std::unique_lock.
+ *
+ * Unlike SpinLock, a waiter does not hammer the cache line with test_and_set: it spins
+ * on a relaxed load with exponentially growing runs of CPU pause instructions and only
+ * attempts the exchange once the lock looks free. If the lock is not acquired within
+ * the spin budget, the thread parks on a futex (Drepper, "Futexes Are Tricky", mutex 3):
+ * state 2 marks "locked, maybe with sleepers", and only an unlock that sees state 2
+ * pays for the wake-up system call.
+ *
+ * The spin budget calibrates itself per lock, like glibc's adaptive mutex: it follows
+ * a moving average of the spins that were actually needed to get the lock, capped at
+ * max_spins. Short critical sections keep a budget that avoids sleeping; when the holder
+ * is preempted or the lock is held for long, spinning fails, the budget shrinks and
+ * waiters park right away instead of burning their timeslice.
+ */
+class AdaptiveLock
+{
+private:
+    enum : int { unlocked = 0, locked = 1, contended = 2 };
+    enum : int { max_spins = 1000, max_pause = 64 }; // enums, usable by std::min without out-of-line definitions in C++11
+
+    std::atomic<int> state{unlocked};
+    std::atomic<int> spin_estimate{max_spins / 10};
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void wait() {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAIT_PRIVATE, int(contended), nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void wake() {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+    }
+
+    bool try_acquire() {
+        int expected = unlocked;
+        return state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void adapt(int spins) {
+        int const e = spin_estimate.load(std::memory_order_relaxed);
+        spin_estimate.store(e + (spins - e) / 8, std::memory_order_relaxed);
+    }
+
+public:
+    AdaptiveLock() = default;
+    AdaptiveLock(AdaptiveLock const&) = delete;
+    AdaptiveLock& operator=(AdaptiveLock const&) = delete;
+
+    void lock() {
+        if (try_acquire()) return;
+
+        int const budget = std::min<int>(max_spins, 2 * spin_estimate.load(std::memory_order_relaxed) + 10);
+        int pause = 1;
+        for (int spins = 0; spins < budget; spins++) {
+            if (state.load(std::memory_order_relaxed) == unlocked && try_acquire()) {
+                adapt(spins);
+                return;
+            }
+            for (int i = 0; i < pause; i++) cpu_relax();
+            pause = std::min<int>(2 * pause, max_pause);
+        }
+        adapt(budget);
+
+        // from here on the lock is taken in the contended state, so our unlock wakes the next sleeper
+        while (state.exchange(contended, std::memory_order_acquire) != unlocked) {
+            wait();
+        }
+    }
+
+    bool try_lock() {
+        return state.load(std::memory_order_relaxed) == unlocked && try_acquire();
+    }
+
+    void unlock() {
+        if (state.exchange(unlocked, std::memory_order_release) == contended) wake();
+    }
+};
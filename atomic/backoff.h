@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <time.h>
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Backoff policies for spin loops.
+ *
+ * A spinning primitive takes the policy as a template parameter, creates one policy
+ * object per acquisition and calls wait(word, busy) after every failed attempt, where
+ * word is the atomic it spins on and busy the value that made the attempt fail. After
+ * it changed the word so that waiters may proceed (e.g. in unlock()) it calls
+ * Backoff::wake(word). Only FutexBackoff uses the word; the other policies just burn
+ * time and their wake() is empty.
+ *
+ *   NoBackoff           retry at once (test_and_set in a tight loop)
+ *   SleepBackoff        nanosleep(1ns) after every 8 attempts; the kernel rounds the
+ *                       sleep up to the timer slack, tens of microseconds on Linux
+ *   ExponentialBackoff  runs of CPU pause instructions that double up to a cap
+ *   RandomizedBackoff   a random number of pauses below a doubling bound, so waiters
+ *                       that failed together do not retry together
+ *   YieldBackoff        pause for a while, then yield the CPU on every attempt
+ *   FutexBackoff        pause for a while, then sleep on the word until wake()
+ */
+namespace backoff_detail {
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+inline void pause(int n) {
+    for (int i = 0; i < n; ++i) cpu_relax();
+}
+
+}
+
+class NoBackoff
+{
+public:
+    template<typename Word, typename Value>
+    void wait(Word const&, Value) {}
+    template<typename Word>
+    static void wake(Word const&) {}
+};
+
+class SleepBackoff
+{
+private:
+    int i = 0;
+
+public:
+    template<typename Word, typename Value>
+    void wait(Word const&, Value) {
+        static const timespec ns = { 0, 1 };
+        if (++i == 8) {
+            i = 0;
+            nanosleep(&ns, NULL);
+        }
+    }
+    template<typename Word>
+    static void wake(Word const&) {}
+};
+
+class ExponentialBackoff
+{
+private:
+    enum : int { max_pause = 1024 };
+    int n = 1;
+
+public:
+    template<typename Word, typename Value>
+    void wait(Word const&, Value) {
+        backoff_detail::pause(n);
+        n = std::min<int>(2 * n, max_pause);
+    }
+    template<typename Word>
+    static void wake(Word const&) {}
+};
+
+class RandomizedBackoff
+{
+private:
+    enum : int { max_pause = 1024 };
+    int bound = 2;
+
+    static std::uint32_t random() {
+        static thread_local std::uint32_t x = 2463534242u ^ std::uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        x ^= x << 13; // xorshift32
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+public:
+    template<typename Word, typename Value>
+    void wait(Word const&, Value) {
+        backoff_detail::pause(int(random() % std::uint32_t(bound)));
+        bound = std::min<int>(2 * bound, max_pause);
+    }
+    template<typename Word>
+    static void wake(Word const&) {}
+};
+
+class YieldBackoff
+{
+private:
+    enum : int { spins = 64 };
+    int i = 0;
+
+public:
+    template<typename Word, typename Value>
+    void wait(Word const&, Value) {
+        if (i < spins) {
+            ++i;
+            backoff_detail::cpu_relax();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    template<typename Word>
+    static void wake(Word const&) {}
+};
+
+// Parks on the low 32 bits of the word (futexes are 32-bit), so the word must be 4 or
+// 8 bytes and the machine little-endian. A hashed table of parked-thread counts lets
+// wake() skip the system call when nobody sleeps on the word (or on another word with
+// the same hash). wake() wakes every sleeper, since all of them wait for the same word
+// to change (readers waiting for a writer all may proceed).
+class FutexBackoff
+{
+private:
+    enum : int { spins = 100, buckets = 64 };
+    int i = 0;
+
+    static std::atomic<int>& parked(void const* word) {
+        static std::atomic<int> table[buckets];
+        return table[(reinterpret_cast<std::uintptr_t>(word) >> 3) % buckets];
+    }
+
+    template<typename T>
+    static std::uint64_t bits(T* p) { return reinterpret_cast<std::uintptr_t>(p); }
+    template<typename T>
+    static std::uint64_t bits(T v) { return static_cast<std::uint64_t>(v); }
+
+public:
+    template<typename Word, typename Value>
+    void wait(Word const& word, Value busy) {
+        static_assert(sizeof(Word) == 4 || sizeof(Word) == 8, "futexes wait on 32-bit words");
+#if defined(__linux__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (i < spins) {
+            ++i;
+            backoff_detail::pause(4);
+            return;
+        }
+        std::atomic<int>& n = parked(&word);
+        n.fetch_add(1); // seq_cst: either wake() sees us or we see the new word value
+        syscall(SYS_futex, reinterpret_cast<int const*>(&word), FUTEX_WAIT_PRIVATE,
+                static_cast<int>(static_cast<std::uint32_t>(bits(busy))), nullptr, nullptr, 0);
+        n.fetch_sub(1, std::memory_order_relaxed);
+#else
+        (void)word;
+        (void)busy;
+        std::this_thread::yield();
+#endif
+    }
+
+    template<typename Word>
+    static void wake(Word const& word) {
+#if defined(__linux__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked(&word).load(std::memory_order_relaxed) == 0) return;
+        syscall(SYS_futex, reinterpret_cast<int const*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+};
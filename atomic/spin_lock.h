@@ -2,6 +2,8 @@
 #include <atomic>
 #include <thread>
 
+#include "backoff.h"
+
 class SpinLock
 {
 private:
@@ -15,4 +17,27 @@ public:
     void unlock() {
         flag.clear();
     }
-};
\ No newline at end of file
+};
+
+// The same test-and-set lock on a std::atomic<int> (futexes need a 32-bit word), with
+// Backoff (see backoff.h) deciding how to wait between attempts.
+// BasicSpinLock<NoBackoff> behaves like SpinLock.
+template<typename Backoff>
+class BasicSpinLock
+{
+private:
+    std::atomic<int> flag{0};
+
+public:
+    void lock() {
+        Backoff backoff;
+        while (flag.exchange(1, std::memory_order_acquire)) {
+            backoff.wait(flag, 1);
+        }
+    }
+
+    void unlock() {
+        flag.store(0, std::memory_order_release);
+        Backoff::wake(flag);
+    }
+};
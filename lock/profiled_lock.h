@@ -0,0 +1,266 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Contention profiling for mutexes.
+ *
+ * profiled_lock<Mutex> wraps any Lockable and is a Lockable itself, so it can replace a
+ * std::mutex guarded by std::lock_guard / std::unique_lock / std::scoped_lock (with
+ * std::condition_variable_any where a condition variable is needed). Every lock has a
+ * site name; all locks with the same name are accounted together, e.g. all instances
+ * of one container class.
+ *
+ * Per site it records the number of acquisitions, how many of them found the lock
+ * taken, and log2 histograms of the time spent waiting for and holding the lock.
+ * Timestamps are TSC reads on x86 (steady_clock elsewhere). Every thread accumulates
+ * into its own buffer, so profiling adds no shared writes beyond the lock's own.
+ *
+ * lock_profile::report() prints all sites sorted by total wait time, i.e. the hottest
+ * lock first; lock_profile::report_at_exit() prints the report when the program exits.
+ */
+namespace lock_profile {
+
+constexpr std::size_t max_sites = 64;
+constexpr std::size_t buckets = 48; // bucket i counts durations in [2^(i-1), 2^i) ticks
+
+inline std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// one thread writes, report() reads concurrently: relaxed atomics, incremented with load + store
+struct counter {
+    std::atomic<std::uint64_t> v{0};
+
+    void add(std::uint64_t n) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    std::uint64_t get() const { return v.load(std::memory_order_relaxed); }
+};
+
+struct site_stats {
+    counter acquisitions;
+    counter contended;
+    counter wait_ticks;
+    counter hold_ticks;
+    std::array<counter, buckets> wait_hist;
+    std::array<counter, buckets> hold_hist;
+
+    static std::size_t bucket(std::uint64_t ticks) {
+        std::size_t const b = ticks ? 64 - __builtin_clzll(ticks) : 0;
+        return std::min(b, buckets - 1);
+    }
+
+    void record(bool was_contended, std::uint64_t wait, std::uint64_t hold) {
+        acquisitions.add(1);
+        if (was_contended) {
+            contended.add(1);
+            wait_ticks.add(wait);
+        }
+        hold_ticks.add(hold);
+        wait_hist[bucket(wait)].add(1);
+        hold_hist[bucket(hold)].add(1);
+    }
+
+    void merge(site_stats const& o) {
+        acquisitions.add(o.acquisitions.get());
+        contended.add(o.contended.get());
+        wait_ticks.add(o.wait_ticks.get());
+        hold_ticks.add(o.hold_ticks.get());
+        for (std::size_t i = 0; i < buckets; i++) {
+            wait_hist[i].add(o.wait_hist[i].get());
+            hold_hist[i].add(o.hold_hist[i].get());
+        }
+    }
+};
+
+using thread_buffer = std::array<site_stats, max_sites>;
+
+class registry
+{
+private:
+    std::mutex m;
+    std::vector<std::string> names;
+    std::vector<thread_buffer*> live;
+    thread_buffer exited; // merged buffers of threads that are gone
+
+public:
+    static registry& get() {
+        static registry* r = new registry; // never destroyed, usable from exit handlers
+        return *r;
+    }
+
+    std::size_t site(std::string const& name) {
+        std::lock_guard lock(m);
+        auto const it = std::find(names.begin(), names.end(), name);
+        if (it != names.end()) return static_cast<std::size_t>(it - names.begin());
+        if (names.size() == max_sites) return max_sites - 1; // the last site collects the overflow
+        names.push_back(name);
+        return names.size() - 1;
+    }
+
+    void attach(thread_buffer* b) {
+        std::lock_guard lock(m);
+        live.push_back(b);
+    }
+
+    void detach(thread_buffer* b) {
+        std::lock_guard lock(m);
+        for (std::size_t i = 0; i < max_sites; i++) exited[i].merge((*b)[i]);
+        live.erase(std::find(live.begin(), live.end(), b));
+    }
+
+    std::vector<std::string> site_names() {
+        std::lock_guard lock(m);
+        return names;
+    }
+
+    // totals per site over all live and exited threads
+    std::unique_ptr<thread_buffer> collect() {
+        auto total = std::make_unique<thread_buffer>();
+        std::lock_guard lock(m);
+        for (std::size_t i = 0; i < max_sites; i++) {
+            (*total)[i].merge(exited[i]);
+            for (thread_buffer* b : live) (*total)[i].merge((*b)[i]);
+        }
+        return total;
+    }
+};
+
+inline site_stats& local(std::size_t site) {
+    struct holder {
+        std::unique_ptr<thread_buffer> b{new thread_buffer};
+        holder() { registry::get().attach(b.get()); }
+        ~holder() { registry::get().detach(b.get()); }
+    };
+    thread_local holder h;
+    return (*h.b)[site];
+}
+
+// ticks per nanosecond, measured once against steady_clock
+inline double ticks_per_ns() {
+    static double const ratio = [] {
+        auto const t0 = std::chrono::steady_clock::now();
+        std::uint64_t const c0 = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::uint64_t const c1 = now();
+        std::chrono::duration<double, std::nano> const ns = std::chrono::steady_clock::now() - t0;
+        return double(c1 - c0) / ns.count();
+    }();
+    return ratio;
+}
+
+inline double percentile_ns(std::array<counter, buckets> const& hist, std::uint64_t total, double p) {
+    if (total == 0) return 0;
+    auto const target = static_cast<std::uint64_t>(p * double(total));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets; i++) {
+        seen += hist[i].get();
+        if (seen > target) return double(std::uint64_t{1} << i) / ticks_per_ns(); // bucket upper bound
+    }
+    return double(std::uint64_t{1} << (buckets - 1)) / ticks_per_ns();
+}
+
+// Prints one line per lock site, hottest (most total wait time) first.
+// Percentiles are upper bounds of power-of-two buckets.
+inline void report(std::ostream& os = std::cerr) {
+    registry& r = registry::get();
+    std::vector<std::string> const names = r.site_names();
+    std::unique_ptr<thread_buffer> const total = r.collect();
+    double const tpn = ticks_per_ns();
+
+    std::vector<std::size_t> order(names.size());
+    for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return (*total)[a].wait_ticks.get() > (*total)[b].wait_ticks.get();
+    });
+
+    os << std::left << std::setw(24) << "lock site" << std::right
+       << std::setw(12) << "acquired" << std::setw(11) << "contended"
+       << std::setw(14) << "wait total" << std::setw(12) << "wait p50" << std::setw(12) << "wait p99"
+       << std::setw(12) << "hold avg" << std::setw(12) << "hold p99" << "\n";
+    for (std::size_t i : order) {
+        site_stats const& s = (*total)[i];
+        std::uint64_t const n = s.acquisitions.get();
+        if (n == 0) continue;
+        os << std::left << std::setw(24) << names[i] << std::right << std::fixed << std::setprecision(1)
+           << std::setw(12) << n
+           << std::setw(10) << 100.0 * double(s.contended.get()) / double(n) << "%"
+           << std::setw(12) << double(s.wait_ticks.get()) / tpn / 1e6 << "ms"
+           << std::setw(10) << percentile_ns(s.wait_hist, n, 0.50) << "ns"
+           << std::setw(10) << percentile_ns(s.wait_hist, n, 0.99) << "ns"
+           << std::setw(10) << double(s.hold_ticks.get()) / tpn / double(n) << "ns"
+           << std::setw(10) << percentile_ns(s.hold_hist, n, 0.99) << "ns" << "\n";
+    }
+}
+
+inline void report_at_exit() {
+    ticks_per_ns(); // calibrate now rather than while the program exits
+    std::atexit([] { report(std::cerr); });
+}
+
+}
+
+template<typename Mutex = std::mutex>
+class profiled_lock
+{
+private:
+    Mutex m;
+    std::size_t const site;
+    bool contended = false;      // written and read by the lock holder only
+    std::uint64_t wait = 0;
+    std::uint64_t acquired_at = 0;
+
+public:
+    explicit profiled_lock(std::string const& site_name) : site{lock_profile::registry::get().site(site_name)} {}
+    profiled_lock(profiled_lock const&) = delete;
+    profiled_lock& operator=(profiled_lock const&) = delete;
+
+    void lock() {
+        if (m.try_lock()) {
+            contended = false;
+            wait = 0;
+            acquired_at = lock_profile::now();
+            return;
+        }
+        std::uint64_t const start = lock_profile::now();
+        m.lock();
+        acquired_at = lock_profile::now();
+        contended = true;
+        wait = acquired_at - start;
+    }
+
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        contended = false;
+        wait = 0;
+        acquired_at = lock_profile::now();
+        return true;
+    }
+
+    void unlock() {
+        std::uint64_t const hold = lock_profile::now() - acquired_at;
+        bool const c = contended;
+        std::uint64_t const w = wait;
+        m.unlock();
+        lock_profile::local(site).record(c, w, hold);
+    }
+};
@@ -2,11 +2,22 @@
 #include <errno.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "benchmark/benchmark.h"
 
+#include "spin_lock.h"
+#include "adaptive_lock.h"
+#include "backoff.h"
+
 using namespace std;
 
 #define REPEAT2(x) {x} {x}
@@ -27,14 +38,78 @@ void BM_atomic(benchmark::State &state) {
     state.SetItemsProcessed(state.iterations());
 }
 
+// Fairness of a lock: every thread counts its acquisitions until the first thread
+// finishes its iterations; within that window all threads competed for the lock.
+// "fairness" is Jain's index over these counts, 1 when every thread got the lock
+// equally often, 1/threads when one thread got it every time; "acq_min" and "acq_max"
+// are the smallest and largest per-thread count.
+// A thread counts in a plain member outside the critical section and publishes its
+// count once, when it sees the window close or on its last iteration, so the
+// accounting adds no shared write to the lock being measured.
+class Fairness {
+public:
+    static constexpr int max_threads = 1024;
+
+    explicit Fairness(benchmark::State& state) : state_(state) {
+        if (state.threads() > max_threads) {
+            state.SkipWithError("Fairness supports at most 1024 threads");
+            return;
+        }
+        if (state.thread_index() == 0) done_.store(false);
+    }
+    // call after each iteration's critical section
+    void acquired(benchmark::IterationCount i) {
+        if (published_) return;
+        if (!done_.load(std::memory_order_relaxed)) {
+            ++count_;
+            if (i + 1 != state_.max_iterations) return;
+            done_.store(true, std::memory_order_relaxed);
+        }
+        counts_[state_.thread_index()] = count_; // read by thread 0 after the end-of-loop barrier
+        published_ = true;
+    }
+    // call after the benchmark loop, all threads have left it by then
+    void report() {
+        if (state_.thread_index() != 0 || state_.threads() > max_threads) return;
+        double sum = 0, sum_sq = 0;
+        unsigned long lo = counts_[0], hi = counts_[0];
+        for (int t = 0; t < state_.threads(); ++t) {
+            double const n = double(counts_[t]);
+            sum += n;
+            sum_sq += n * n;
+            lo = std::min(lo, counts_[t]);
+            hi = std::max(hi, counts_[t]);
+        }
+        state_.counters["fairness"] = sum_sq > 0 ? sum * sum / (state_.threads() * sum_sq) : 1.0;
+        state_.counters["acq_min"] = double(lo);
+        state_.counters["acq_max"] = double(hi);
+    }
+
+private:
+    static unsigned long counts_[max_threads];
+    static std::atomic<bool> done_;
+
+    benchmark::State& state_;
+    unsigned long count_ = 0;
+    bool published_ = false;
+};
+unsigned long Fairness::counts_[Fairness::max_threads];
+std::atomic<bool> Fairness::done_(false);
+
 unsigned long x = 0;
 std::mutex M;
 void BM_mutex(benchmark::State& state) {
     if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
     for (auto _ : state) {
-        std::lock_guard<std::mutex> L(M);
-        benchmark::DoNotOptimize(++x);
+        {
+            std::lock_guard<std::mutex> L(M);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
     }
+    F.report();
     state.SetItemsProcessed(state.iterations());
 }
 
@@ -48,58 +123,287 @@ void BM_cas(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations());
 }
 
-class Spinlock {
+// Test-and-test-and-set lock; Backoff (atomic/backoff.h) waits between attempts.
+template<typename Backoff>
+class BasicSpinlock {
 public:
-    Spinlock() : flag_(0) {}
+    BasicSpinlock() : flag_(0) {}
     void lock() {
-        static const timespec ns = { 0, 1 };
-        for (int i = 0; flag_.load(std::memory_order_relaxed) || flag_.exchange(1, std::memory_order_acquire); ++i) {
-            if (i == 8) {
-                i = 0;
-                nanosleep(&ns, NULL);
-            }
+        Backoff backoff;
+        while (flag_.load(std::memory_order_relaxed) || flag_.exchange(1, std::memory_order_acquire)) {
+            backoff.wait(flag_, 1u);
         }
     }
-    void unlock() { flag_.store(0, std::memory_order_release); }
+    void unlock() {
+        flag_.store(0, std::memory_order_release);
+        Backoff::wake(flag_);
+    }
 
 private:
     std::atomic<unsigned int> flag_;
 };
+using Spinlock = BasicSpinlock<SleepBackoff>;
 
 Spinlock S;
 void BM_spinlock(benchmark::State& state) {
     if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
     for (auto _ : state) {
-        std::lock_guard<Spinlock> L(S);
-        benchmark::DoNotOptimize(++x);
+        {
+            std::lock_guard<Spinlock> L(S);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// atomic/spin_lock.h: test_and_set in a tight loop, no pause, never sleeps
+SpinLock B;
+void BM_busy_spinlock(benchmark::State& state) {
+    if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<SpinLock> L(B);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+AdaptiveLock A;
+void BM_adaptive_lock(benchmark::State& state) {
+    if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<AdaptiveLock> L(A);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Spins on a waiter-private location; yields now and then so a preempted lock holder
+// (or the next waiter in a FIFO lock) gets the CPU back when threads > CPUs.
+template<typename Ready>
+static void spin_until(Ready ready) {
+    for (int i = 0; !ready(); ++i) {
+        if (i == 1024) {
+            i = 0;
+            std::this_thread::yield();
+        }
+        cpu_relax();
+    }
+}
+
+// Ticket lock: FIFO, but all waiters still read the same now_serving line.
+// Waiters pause in proportion to their distance from the head of the line.
+class TicketLock {
+public:
+    TicketLock() : next_(0), serving_(0) {}
+    void lock() {
+        unsigned const ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        spin_until([&] {
+            unsigned const serving = serving_.load(std::memory_order_acquire);
+            if (serving == ticket) return true;
+            for (unsigned i = 0; i < ticket - serving; ++i) cpu_relax();
+            return false;
+        });
+    }
+    void unlock() {
+        serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    std::atomic<unsigned> next_;
+    std::atomic<unsigned> serving_;
+};
+
+// Per-thread queue nodes of the MCS and CLH locks. lock() takes the next node and
+// unlock() gives it back, so one thread may hold several of these locks at a time
+// as long as it releases them in reverse order (as nested lock_guards do).
+template<typename Node>
+class QueueNodes {
+public:
+    static Node*& acquire() { return local().nodes[local().depth++]; }
+    static Node*& release() { return local().nodes[--local().depth]; }
+
+private:
+    static constexpr int max_nesting = 8;
+    struct Nodes {
+        Node* nodes[max_nesting];
+        int depth = 0;
+        Nodes() { for (auto& n : nodes) n = new Node; }
+        ~Nodes() { for (auto n : nodes) delete n; }
+    };
+    static Nodes& local() {
+        static thread_local Nodes n;
+        return n;
+    }
+};
+
+// MCS lock (Mellor-Crummey and Scott, 1991): waiters form a linked queue and each one
+// spins on the flag of its own node until its predecessor hands the lock over.
+class MCSLock {
+public:
+    MCSLock() : tail_(nullptr), owner_(nullptr) {}
+    void lock() {
+        Node* const n = QueueNodes<Node>::acquire();
+        n->next.store(nullptr, std::memory_order_relaxed);
+        n->locked.store(true, std::memory_order_relaxed);
+        Node* const pred = tail_.exchange(n, std::memory_order_acq_rel);
+        if (pred) {
+            pred->next.store(n, std::memory_order_release);
+            spin_until([n] { return !n->locked.load(std::memory_order_acquire); });
+        }
+        owner_ = n;
+    }
+    void unlock() {
+        Node* const n = owner_;
+        QueueNodes<Node>::release();
+        Node* succ = n->next.load(std::memory_order_acquire);
+        if (!succ) {
+            Node* expected = n;
+            if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) return;
+            // a successor swapped itself in but has not linked yet
+            spin_until([&] { return (succ = n->next.load(std::memory_order_acquire)) != nullptr; });
+        }
+        succ->locked.store(false, std::memory_order_release);
+    }
+
+private:
+    struct alignas(64) Node {
+        std::atomic<Node*> next;
+        std::atomic<bool> locked;
+    };
+    std::atomic<Node*> tail_;
+    Node* owner_; // written and read by the lock holder only
+};
+
+// CLH lock (Craig; Landin and Hagersten): each waiter spins on its predecessor's node.
+// The releasing thread keeps its predecessor's node for its next acquisition, its own
+// node stays in the queue until the successor is done with it.
+class CLHLock {
+public:
+    CLHLock() : tail_(new Node), owner_(nullptr), pred_(nullptr) {
+        tail_.load()->locked.store(false);
+    }
+    ~CLHLock() { delete tail_.load(); }
+    void lock() {
+        Node*& mine = QueueNodes<Node>::acquire();
+        Node* const n = mine;
+        n->locked.store(true, std::memory_order_relaxed);
+        Node* const pred = tail_.exchange(n, std::memory_order_acq_rel);
+        spin_until([pred] { return !pred->locked.load(std::memory_order_acquire); });
+        owner_ = n;
+        pred_ = pred;
+    }
+    void unlock() {
+        Node*& mine = QueueNodes<Node>::release();
+        Node* const n = owner_;
+        mine = pred_;
+        n->locked.store(false, std::memory_order_release);
+    }
+
+private:
+    struct alignas(64) Node {
+        std::atomic<bool> locked;
+    };
+    std::atomic<Node*> tail_;
+    Node* owner_; // written and read by the lock holder only
+    Node* pred_;
+};
+
+TicketLock T;
+void BM_ticket_lock(benchmark::State& state) {
+    if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<TicketLock> L(T);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+MCSLock Q;
+void BM_mcs_lock(benchmark::State& state) {
+    if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<MCSLock> L(Q);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+CLHLock C;
+void BM_clh_lock(benchmark::State& state) {
+    if (state.thread_index() == 0) x = 0;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<CLHLock> L(C);
+            benchmark::DoNotOptimize(++x);
+        }
+        F.acquired(i++);
     }
+    F.report();
     state.SetItemsProcessed(state.iterations());
 }
 
-class Ptrlock
+template<typename Backoff>
+class BasicPtrlock
 {
 public:
-    Ptrlock(std::atomic<unsigned long*>& p) : p_{p}, p_save_{nullptr} {}
+    BasicPtrlock(std::atomic<unsigned long*>& p) : p_{p}, p_save_{nullptr} {}
     unsigned long* lock() {
-        static const timespec ns = { 0, 1 };
+        Backoff backoff;
         unsigned long* p = nullptr;
-        
-        for (int i = 0; !p_.load(std::memory_order_relaxed) || !(p = p_.exchange(nullptr, std::memory_order_acquire)); ++i) {
-            if (i == 8) {
-                i = 0;
-                nanosleep(&ns, NULL);
-            }
+
+        while (!p_.load(std::memory_order_relaxed) || !(p = p_.exchange(nullptr, std::memory_order_acquire))) {
+            backoff.wait(p_, static_cast<unsigned long*>(nullptr));
         }
         return p_save_ = p;
     }
     void unlock() {
         p_.store(p_save_, std::memory_order_release);
+        Backoff::wake(p_);
     }
 
 private:
     std::atomic<unsigned long*>& p_;
     unsigned long* p_save_;
 };
+using Ptrlock = BasicPtrlock<SleepBackoff>;
 
 std::atomic<unsigned long*> p(new unsigned long);
 void BM_ptrlock(benchmark::State& state) {
@@ -113,16 +417,209 @@ void BM_ptrlock(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations());
 }
 
+// Optimistic versioned pointer lock. Ptrlock takes the pointer away even from threads
+// that only want to read through it; here the pointer shares one 64-bit word with a
+// 16-bit version in the high bits and a writer bit in bit 0. A reader never writes:
+// it reads the word, reads through the pointer and reads the word again, and retries
+// if a writer held the lock or the version changed in between (the seqlock scheme).
+// A writer sets the writer bit, changes the data (or publishes another pointer with
+// unlock(p)) and bumps the version on unlock.
+// Readers may see the data while a writer changes it, so the data must be read with
+// (relaxed) atomics and the read function must not act on what it read until read()
+// returns. An object replaced by unlock(p) must outlive the readers still using it.
+// Backoff (atomic/backoff.h) waits while a writer holds the word.
+// The version wraps after 65536 writes; a reader that is preempted for exactly that
+// many writes would accept a torn read.
+template<typename T, typename Backoff = SleepBackoff>
+class VersionedPtr {
+public:
+    explicit VersionedPtr(T* p) : w_(reinterpret_cast<std::uintptr_t>(p)), held_(0) {}
+
+    // f(T const*) runs until it has seen a consistent snapshot, its result is returned
+    template<typename F>
+    auto read(F f) const -> decltype(f(static_cast<T const*>(nullptr))) {
+        Backoff backoff;
+        for (;;) {
+            std::uint64_t const w1 = w_.load(std::memory_order_acquire);
+            if (!(w1 & writer)) {
+                auto r = f(ptr(w1));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (w_.load(std::memory_order_relaxed) == w1) return r;
+            }
+            else {
+                backoff.wait(w_, w1);
+            }
+        }
+    }
+
+    T* lock() {
+        Backoff backoff;
+        for (;;) {
+            std::uint64_t w = w_.load(std::memory_order_relaxed);
+            if (!(w & writer) && w_.compare_exchange_weak(w, w | writer, std::memory_order_acquire, std::memory_order_relaxed)) {
+                // orders the writer bit before the data writes for readers that see them
+                std::atomic_thread_fence(std::memory_order_release);
+                held_ = w;
+                return ptr(w);
+            }
+            if (w & writer) backoff.wait(w_, w);
+        }
+    }
+    void unlock() { unlock(ptr(held_)); }
+    void unlock(T* p) {
+        std::uint64_t const version = ((held_ >> version_shift) + 1) << version_shift;
+        w_.store(version | reinterpret_cast<std::uintptr_t>(p), std::memory_order_release);
+        Backoff::wake(w_);
+    }
+
+private:
+    static_assert(sizeof(void*) == 8, "the version shares a 64-bit word with the pointer");
+    static_assert(alignof(T) >= 2, "bit 0 of the pointer holds the writer bit");
+    static constexpr int version_shift = 48;
+    static constexpr std::uint64_t writer = 1;
+    static constexpr std::uint64_t ptr_mask = ((std::uint64_t(1) << version_shift) - 1) & ~writer;
+
+    static T* ptr(std::uint64_t w) { return reinterpret_cast<T*>(w & ptr_mask); }
+
+    std::atomic<std::uint64_t> w_;
+    std::uint64_t held_; // written and read by the lock holder only
+};
+
+// Ptrlock as a BasicLockable that owns the pointer it locks, for the lock matrix.
+// lock() stores the taken pointer in the Ptrlock, which only the holder touches.
+class PtrMutex {
+public:
+    PtrMutex() : p_(&value_), l_(p_) {}
+    void lock() { l_.lock(); }
+    void unlock() { l_.unlock(); }
+
+private:
+    unsigned long value_ = 0;
+    std::atomic<unsigned long*> p_;
+    Ptrlock l_;
+};
+
+// What std::lock_guard needs from a lock: lock() and unlock().
+template<typename Lock, typename = void>
+struct is_basic_lockable : std::false_type {};
+template<typename Lock>
+struct is_basic_lockable<Lock, std::void_t<decltype(std::declval<Lock&>().lock()),
+                                           decltype(std::declval<Lock&>().unlock())>> : std::true_type {};
+
+// The lock matrix: the bare ++x above measures nothing but the lock hand-off, here
+// every iteration takes one of range(2) locks, does range(0) increments of the data
+// that lock guards and then range(1) increments of thread-local data before the next
+// acquisition. Short critical sections with no work in between is the worst case for
+// contention; long non-critical work makes the lock nearly uncontended. Thread i
+// starts at lock i and moves to the next lock every iteration, so with several locks
+// threads mostly collide on different locks.
+template<typename Lock>
+void BM_lock_matrix(benchmark::State& state) {
+    static_assert(is_basic_lockable<Lock>::value, "BM_lock_matrix needs lock() and unlock()");
+    static constexpr int max_locks = 16;
+    struct alignas(64) Guarded {
+        Lock lock;
+        unsigned long data = 0;
+    };
+    static Guarded guarded[max_locks];
+
+    long const critical = state.range(0);
+    long const noncritical = state.range(1);
+    long const nlocks = std::min<long>(state.range(2), max_locks);
+    unsigned long local = 0;
+    long k = state.thread_index() % nlocks;
+    Fairness F(state);
+    benchmark::IterationCount i = 0;
+    for (auto _ : state) {
+        Guarded& g = guarded[k];
+        {
+            std::lock_guard<Lock> L(g.lock);
+            for (long j = 0; j < critical; ++j) benchmark::DoNotOptimize(++g.data);
+        }
+        F.acquired(i++);
+        for (long j = 0; j < noncritical; ++j) benchmark::DoNotOptimize(++local);
+        if (++k == nlocks) k = 0;
+    }
+    F.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Read-heavy and write-heavy use of a lock-protected pointer: range(0) of every 1000
+// operations read the value, the rest increment it. With Ptrlock every read takes
+// the pointer exclusively, with VersionedPtr reads only load the lock word.
+static bool is_read(benchmark::State& state, unsigned long i) {
+    return long(i % 1000) < state.range(0);
+}
+
+void BM_ptrlock_mix(benchmark::State& state) {
+    if (state.thread_index() == 0) *p.load() = 0;
+    Ptrlock L(p);
+    unsigned long i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        unsigned long* pl = L.lock();
+        if (is_read(state, i++)) benchmark::DoNotOptimize(*pl);
+        else benchmark::DoNotOptimize(++*pl);
+        L.unlock();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+std::atomic<unsigned long> vx(0);
+VersionedPtr<std::atomic<unsigned long>> V(&vx);
+void BM_versioned_ptr_mix(benchmark::State& state) {
+    if (state.thread_index() == 0) vx = 0;
+    unsigned long i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        if (is_read(state, i++)) {
+            benchmark::DoNotOptimize(V.read([](std::atomic<unsigned long> const* v) {
+                return v->load(std::memory_order_relaxed);
+            }));
+        } else {
+            std::atomic<unsigned long>* const v = V.lock();
+            v->store(v->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            V.unlock();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
 static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
 
 #define ARGS \
   ->ThreadRange(1, numcpu) \
   ->UseRealTime()
 
+// more threads than CPUs: lock holders get preempted
+#define OVERSUBSCRIBED \
+  ARGS \
+  ->Threads(2 * numcpu) \
+  ->Threads(4 * numcpu)
+
 BENCHMARK(BM_atomic) ARGS;
-BENCHMARK(BM_mutex) ARGS;
+BENCHMARK(BM_mutex) OVERSUBSCRIBED;
 BENCHMARK(BM_cas) ARGS;
-BENCHMARK(BM_spinlock) ARGS;
+BENCHMARK(BM_spinlock) OVERSUBSCRIBED;
+BENCHMARK(BM_busy_spinlock) OVERSUBSCRIBED;
+BENCHMARK(BM_adaptive_lock) OVERSUBSCRIBED;
+BENCHMARK(BM_ticket_lock) ARGS;
+BENCHMARK(BM_mcs_lock) ARGS;
+BENCHMARK(BM_clh_lock) ARGS;
 BENCHMARK(BM_ptrlock) ARGS;
+BENCHMARK(BM_ptrlock_mix) ->ArgName("reads_per_1000")->Arg(1000)->Arg(990)->Arg(500) ARGS;
+BENCHMARK(BM_versioned_ptr_mix) ->ArgName("reads_per_1000")->Arg(1000)->Arg(990)->Arg(500) ARGS;
+
+#define MATRIX \
+  ->ArgNames({"critical", "noncritical", "locks"}) \
+  ->ArgsProduct({{1, 16, 256}, {0, 64, 1024}, {1, 4}}) \
+  OVERSUBSCRIBED
+
+BENCHMARK_TEMPLATE(BM_lock_matrix, std::mutex) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, Spinlock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, SpinLock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, AdaptiveLock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, TicketLock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, MCSLock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, CLHLock) MATRIX;
+BENCHMARK_TEMPLATE(BM_lock_matrix, PtrMutex) MATRIX;
 
 BENCHMARK_MAIN();
\ No newline at end of file
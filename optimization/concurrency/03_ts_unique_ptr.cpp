@@ -4,6 +4,8 @@
 
 #include "benchmark/benchmark.h"
 
+#include "epoch.h"
+
 #define REPEAT2(x) {x} {x}
 #define REPEAT4(x) REPEAT2(x) REPEAT2(x)
 #define REPEAT8(x) REPEAT4(x) REPEAT4(x)
@@ -31,6 +33,12 @@ public:
     void publish(T* p) noexcept {
         p_.store(p, std::memory_order_release);
     }
+    // Replaces the pointer and frees the old object once no reader can still see it.
+    // Readers that may race with this must read inside an epoch::guard; get() itself
+    // stays a single acquire load.
+    void publish_and_retire(T* p) {
+        if (T* const old = p_.exchange(p, std::memory_order_seq_cst)) epoch::retire(old);
+    }
     const T* get() const noexcept {
         return p_.load(std::memory_order_acquire);
     }
@@ -85,8 +93,30 @@ void BM_raw_ptr_deref(benchmark::State& state) {
     state.SetItemsProcessed(32 * state.iterations());
 }
 
+// Read throughput while the object is republished all the time: thread 0 publishes a
+// new object per iteration and retires the old one, the other threads read 64 times per
+// epoch region. With a single thread it does both. "reads" and "publishes" are rates.
+ts_unique_ptr<A> rp_live(new A(42));
+void BM_ptr_deref_republish(benchmark::State& state) {
+    bool const writer = state.thread_index() == 0;
+    bool const reader = !writer || state.threads() == 1;
+    volatile A x;
+    int i = 0;
+    for (auto _ : state) {
+        if (reader) {
+            epoch::guard g;
+            REPEAT(benchmark::DoNotOptimize(x = *rp_live);)
+        }
+        if (writer) rp_live.publish_and_retire(new A(++i));
+    }
+    state.counters["reads"] = benchmark::Counter(reader ? 64 * state.iterations() : 0, benchmark::Counter::kIsRate);
+    state.counters["publishes"] = benchmark::Counter(writer ? state.iterations() : 0, benchmark::Counter::kIsRate);
+}
+
 static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
 
+// BM_ptr_deref_republish claims an epoch record per thread and throws when all
+// epoch::max_threads() records (4 per CPU, at least 128) are taken.
 #define ARGS \
     ->ThreadRange(1, numcpu) \
     ->UseRealTime()
@@ -94,5 +124,6 @@ static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
 BENCHMARK(BM_ptr_deref) ARGS;
 BENCHMARK(BM_ptr_assign) ARGS;
 BENCHMARK(BM_raw_ptr_deref) ARGS;
+BENCHMARK(BM_ptr_deref_republish) ARGS;
 
 BENCHMARK_MAIN();
\ No newline at end of file
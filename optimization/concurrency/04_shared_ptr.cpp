@@ -1,5 +1,7 @@
 #include <unistd.h>
 #include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <memory>
 
 #include "benchmark/benchmark.h"
@@ -84,6 +86,27 @@ void BM_atomic_shared_ptr_deref(benchmark::State& state) {
     state.SetItemsProcessed(64 * state.iterations());
 }
 
+// Lock-free atomic intrusive shared pointer with split reference counts.
+// The 64-bit word holds the pointer in the low 48 bits and, in the high 16 bits, a
+// local count of threads that are between loading the pointer and taking their own
+// reference. A thread takes a unit of the local count together with loading the
+// pointer (one fetch_add); while it holds the unit the object stays alive. get() then
+// calls AddRef() and gives its unit back with a CAS.
+// A writer swaps the word out with a CAS while holding a unit itself, so the object it
+// swaps out is alive. Before the CAS it calls AddRef() once for every other unit in
+// the word it expects to swap out, so at the moment the word changes every thread in
+// flight on it already owns a reference. After a successful CAS it drops the reference
+// the intr_shared_ptr held and those it added for units that were given back meanwhile.
+// A thread whose unit was taken over (its CAS finds the pointer gone or the local count
+// already empty) owns the reference the writer added for it; get() drops its own extra
+// one with DelRef(). Nobody ever waits for anybody: a reader retries its CAS only when
+// another thread changed the word, a writer retries only when another thread did so.
+// If the same object is stored again while a thread is in flight, that thread may give
+// back a unit of the new word; the thread that misses it then finds the count short and
+// owns the surplus reference the first one was given, so the totals still balance.
+// Every thread holds at most one unit at a time, so the 16-bit count can only overflow
+// with 65536 threads inside get()/reset() on the same pointer at the same time.
+//
 // T - type the pointer points to
 // U - T with reference counter
 //     U must have the following member functions:
@@ -92,23 +115,67 @@ void BM_atomic_shared_ptr_deref(benchmark::State& state) {
 template<typename T, typename U = T>
 class intr_shared_ptr
 {
-    struct get_ptr {
-        std::atomic<U*>& aptr;
-        U* p;
-        get_ptr(std::atomic<U*>& ptr) : aptr(ptr), p() {
-            static const timespec ns = { 0 , 1 };
-            for (int i = 0; aptr.load(std::memory_order_relaxed) == (U*)(locked) || (p = aptr.exchange((U*)(locked), std::memory_order_acquire)) == (U*)(locked); ++i) {
-                if (i == 8) {
-                    i = 0;
-                    nanosleep(&ns, NULL);
+    static_assert(sizeof(void*) == 8, "the local count shares a 64-bit word with the pointer");
+    static const int count_shift = 48;
+    static const uint64_t one = uint64_t(1) << count_shift;
+    static const uint64_t ptr_mask = one - 1;
+
+    static U* ptr(uint64_t w) { return reinterpret_cast<U*>(w & ptr_mask); }
+    static uint64_t count(uint64_t w) { return w >> count_shift; }
+    static uint64_t make(U* p) { return reinterpret_cast<uintptr_t>(p); }
+
+    static void drop(U* p, uint64_t n) {
+        if (!p) return;
+        for (uint64_t i = 0; i < n; ++i) {
+            if (p->DelRef()) delete p; // only ever the last of the n
+        }
+    }
+
+    // Takes a unit of the local count; ptr() of the returned word stays alive until
+    // the unit is given back or taken over.
+    uint64_t take_unit() const {
+        uint64_t const w = p_.fetch_add(one) + one;
+        assert(count(w) != 0 && "local count overflow");
+        return w;
+    }
+
+    // Gives the unit taken with the word w back. Returns false if a writer took it over,
+    // the caller then owns the reference the writer added for it.
+    bool give_unit(uint64_t w) const {
+        U* const p = ptr(w);
+        while (ptr(w) == p && count(w) != 0) {
+            // acquire on failure: a lost unit's reference was added before the word changed
+            if (p_.compare_exchange_weak(w, w - one, std::memory_order_release, std::memory_order_acquire)) return true;
+        }
+        return false;
+    }
+
+    // Replaces the pointer with desired, if it is expected or any is set. Returns false if
+    // the pointer was something else.
+    bool swap(uint64_t desired, bool any, U* expected) {
+        for (;;) {
+            uint64_t w = take_unit();
+            U* const p = ptr(w);
+            if (!any && p != expected) {
+                if (!give_unit(w)) drop(p, 1);
+                return false;
+            }
+            uint64_t added = 0; // references added for the other units
+            while (ptr(w) == p && count(w) != 0) {
+                if (p) {
+                    for (; added + 1 < count(w); ++added) p->AddRef();
+                }
+                if (p_.compare_exchange_weak(w, desired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    // our own unit takes over the intr_shared_ptr's reference, drop it and
+                    // what we added for units that were given back before the CAS
+                    drop(p, added + 2 - count(w));
+                    return true;
                 }
             }
+            // our unit was taken over: drop the reference added for it and ours, then retry
+            drop(p, added + 1);
         }
-        ~get_ptr() {
-            aptr.store(p, std::memory_order_release);
-        }
-        static const uintptr_t locked = uintptr_t(-1);
-    };
+    }
 
 public:
     class shared_ptr {
@@ -146,6 +213,8 @@ public:
         explicit shared_ptr(U* p) : p_(p) {
             if (p_) p_->AddRef();
         }
+        struct adopt_t {};
+        shared_ptr(U* p, adopt_t) : p_(p) {} // takes over a reference the caller already holds
         void reset(U* p) {
             if (p_ == p) return;
             if (p_ && p_->DelRef()) {
@@ -157,103 +226,61 @@ public:
         U* p_;
     };
 
-    explicit intr_shared_ptr(U* p = nullptr) : p_(p) {
+    explicit intr_shared_ptr(U* p = nullptr) : p_(make(p)) {
         if (p) p->AddRef();
     }
-    explicit intr_shared_ptr(shared_ptr const& x) : p_() {
+    explicit intr_shared_ptr(shared_ptr const& x) : p_(make(x.p_)) {
         if (x.p_) x.p_->AddRef();
-        p_.store(x.p_, std::memory_order_relaxed);
     }
-    explicit intr_shared_ptr(intr_shared_ptr const& x) : p_() {
-        get_ptr px(x.p_);
-        if (px.p) px.p->AddRef();
-        p_.store(px.p, std::memory_order_relaxed);
+    explicit intr_shared_ptr(intr_shared_ptr const& x) : p_(0) {
+        shared_ptr const px = x.get();
+        if (px.p_) px.p_->AddRef();
+        p_.store(make(px.p_), std::memory_order_relaxed);
     }
     ~intr_shared_ptr() {
-        get_ptr p(p_);
-        if (p.p && p.p->DelRef()) {
-            delete p.p;
-        }
-        p.p = nullptr;
+        drop(ptr(p_.load(std::memory_order_acquire)), 1);
     }
 
     intr_shared_ptr& operator=(intr_shared_ptr const& x) {
         if (this == &x) return *this;
-        
-        U* pxp;
-        {
-            get_ptr px(x.p_);
-            pxp = px.p;
-            if (px.p) px.p->AddRef();
-        }
-        get_ptr p(p_);
-        if (p.p && p.p->DelRef()) {
-            delete p.p;
-        }
-        p.p = pxp;
+        reset(x.get());
         return *this;
     }
     explicit operator bool() const {
-        return p_.load(std::memory_order_relaxed) != nullptr;
+        return ptr(p_.load(std::memory_order_relaxed)) != nullptr;
     }
     void reset(U* x) {
-        get_ptr p(p_);
-        if (p.p == x) return;
-        if (p.p && p.p->DelRef()) {
-            delete p.p;
-        }
-        p.p = x;
         if (x) x->AddRef();
+        swap(make(x), true, nullptr);
     }
     void reset(shared_ptr const& x) {
-        get_ptr p(p_);
-        if (p.p == x.p_) return;
-        if (p.p && p.p->DelRef()) {
-            delete p.p;
-        }
-        p.p = x.p_;
-        if (x.p_) x.p_->AddRef();
+        reset(x.p_);
     }
     shared_ptr get() const {
-        get_ptr p(p_);
-        return shared_ptr(p.p);
+        uint64_t const w = take_unit();
+        U* const p = ptr(w);
+        if (p) p->AddRef();
+        if (!give_unit(w) && p) {
+            p->DelRef(); // the writer that took our unit over added a reference for us
+        }
+        return shared_ptr(p, typename shared_ptr::adopt_t());
     }
     bool compare_exchange_strong(shared_ptr& expected_ptr, shared_ptr const& new_ptr) {
-        get_ptr p(p_);
-        if (p.p == expected_ptr.p_) {
-            if (p.p && p.p->DelRef()) {
-                delete p.p;
-            }
-            p.p = new_ptr.p_;
-            if (p.p) p.p->AddRef();
-            return true;
-        }
-        else {
-            expected_ptr.reset(p.p);
-            return false;
-        }
+        return compare_exchange_strong(expected_ptr, new_ptr.p_);
     }
     bool compare_exchange_strong(shared_ptr& expected_ptr, U* new_ptr) {
-        get_ptr p(p_);
-        if (p.p == expected_ptr.p_) {
-            if (p.p && p.p->DelRef()) {
-                delete p.p;
-            }
-            p.p = new_ptr;
-            if (p.p) p.p->AddRef();
-            return true;
-        }
-        else {
-            expected_ptr.reset(p.p);
-            return false;
-        }
+        if (new_ptr) new_ptr->AddRef(); // before it becomes visible to readers
+        if (swap(make(new_ptr), false, expected_ptr.p_)) return true;
+        if (new_ptr) new_ptr->DelRef(); // the caller still owns new_ptr, even if that was its only reference
+        expected_ptr = get();
+        return false;
     }
 
 private:
-    mutable std::atomic<U*> p_;
+    mutable std::atomic<uint64_t> p_;
 };
 
-static unsigned long B_count = 0;
+static std::atomic<unsigned long> B_count(0);
 struct B : public A {
     std::atomic<unsigned long> ref_cnt_;
 
@@ -280,6 +307,46 @@ void BM_intr_shared_ptr_deref(benchmark::State& state) {
     state.SetItemsProcessed(64 * state.iterations());
 }
 
+// Readers while the pointer keeps changing: every 64th operation of each thread
+// publishes a new object, the old one is freed by whoever drops the last reference.
+intr_shared_ptr<A, B> isp_mut(new B(42));
+void BM_intr_shared_ptr_get_reset(benchmark::State& state) {
+    volatile A x;
+    for (auto _ : state) {
+        REPEAT(benchmark::DoNotOptimize(x = *isp_mut.get());)
+        isp_mut.reset(new B(state.thread_index()));
+    }
+    state.SetItemsProcessed(65 * state.iterations());
+}
+
+// Stress test of the swap paths: every thread mixes get(), reset() and
+// compare_exchange_strong() on one pointer and checks what it reads. "leaked" is the
+// number of B objects alive after the run minus before it, and must be 0; a double free
+// shows up as a negative number, a lost reference as a positive one.
+intr_shared_ptr<A, B> isp_stress(new B(0));
+void BM_intr_shared_ptr_stress(benchmark::State& state) {
+    static long before;
+    if (state.thread_index() == 0) before = long(B_count.load());
+    long bad = 0;
+    int i = state.thread_index();
+    for (auto _ : state) {
+        intr_shared_ptr<A, B>::shared_ptr s = isp_stress.get();
+        if (!s || (*s).i < 0) ++bad;
+        switch (++i % 8) {
+        case 0: isp_stress.reset(new B(i)); break;
+        case 4: {
+            intr_shared_ptr<A, B>::shared_ptr expected = s;
+            B* const n = new B(i);
+            if (!isp_stress.compare_exchange_strong(expected, n)) delete n; // still ours on failure
+            break;
+        }
+        }
+    }
+    state.counters["bad_reads"] = benchmark::Counter(double(bad));
+    if (state.thread_index() == 0) state.counters["leaked"] = double(long(B_count.load()) - before);
+    state.SetItemsProcessed(state.iterations());
+}
+
 static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
 
 #define ARGS \
@@ -290,5 +357,7 @@ BENCHMARK(BM_ts_unique_ptr_deref) ARGS;
 BENCHMARK(BM_shared_ptr_deref) ARGS;
 BENCHMARK(BM_atomic_shared_ptr_deref) ARGS;
 BENCHMARK(BM_intr_shared_ptr_deref) ARGS;
+BENCHMARK(BM_intr_shared_ptr_get_reset) ARGS;
+BENCHMARK(BM_intr_shared_ptr_stress) ARGS->Threads(4);
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <unistd.h>
+#include <atomic>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "bounded_queue.h"
+#include "bench_roles.h"
+
+template<typename Q>
+void producer_consumer(benchmark::State& state, Q& q) {
+    roles const r(state);
+
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        if (r.producer) q.push(++i);
+        if (r.consumer) {
+            q.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_queue<unsigned long> mq;
+void BM_mutex_queue(benchmark::State& state) {
+    producer_consumer(state, mq);
+}
+
+bounded_queue<unsigned long, full_policy::block> bq(1024);
+void BM_bounded_queue(benchmark::State& state) {
+    producer_consumer(state, bq);
+}
+
+// fail-fast mode: producers retry on their own instead of waiting inside push()
+bounded_queue<unsigned long, full_policy::fail> fq(1024);
+void BM_bounded_queue_fail(benchmark::State& state) {
+    roles const r(state);
+
+    unsigned long i = 0, value = 0, full = 0;
+    for (auto _ : state) {
+        if (r.producer) {
+            ++i;
+            while (!fq.push(i)) ++full;
+        }
+        if (r.consumer) {
+            while (!fq.try_pop(value)) {}
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["full"] = benchmark::Counter(full, benchmark::Counter::kAvgThreads);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_queue) ARGS;
+BENCHMARK(BM_bounded_queue) ARGS;
+BENCHMARK(BM_bounded_queue_fail) ARGS;
+
+BENCHMARK_MAIN();
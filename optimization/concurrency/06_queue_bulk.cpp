@@ -0,0 +1,57 @@
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "bench_roles.h"
+
+// Every iteration moves one batch of state.range(0) items from a producer to a consumer.
+
+threadsafe_queue<unsigned long> q1;
+void BM_queue_single(benchmark::State& state) {
+    roles const r(state);
+    long const batch = state.range(0);
+    unsigned long value = 0;
+    for (auto _ : state) {
+        if (r.producer) {
+            for (long i = 0; i < batch; i++) q1.push(i);
+        }
+        if (r.consumer) {
+            for (long i = 0; i < batch; i++) q1.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(batch * state.iterations());
+}
+
+threadsafe_queue<unsigned long> q2;
+void BM_queue_bulk(benchmark::State& state) {
+    roles const r(state);
+    long const batch = state.range(0);
+    std::vector<unsigned long> in(batch), out(batch);
+    for (auto _ : state) {
+        if (r.producer) {
+            q2.push_range(in.begin(), in.end());
+        }
+        if (r.consumer) {
+            for (std::size_t n = 0; n < out.size(); ) {
+                n += q2.wait_and_pop_bulk(out.begin() + n, out.size() - n);
+            }
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    state.SetItemsProcessed(batch * state.iterations());
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->RangeMultiplier(8)->Range(1, 4096) \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_queue_single) ARGS;
+BENCHMARK(BM_queue_bulk) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,58 @@
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "two_lock_queue.h"
+#include "bench_roles.h"
+
+// With a non-zero prefill the queue never runs empty, so producers and consumers only
+// contend with each other if both ends share a lock.
+template<typename Q>
+void producer_consumer(benchmark::State& state, Q& q) {
+    roles const r(state);
+
+    // runs are balanced, so the queue only starts empty on the very first run
+    if (state.thread_index() == 0 && q.empty()) {
+        for (long i = 0; i < state.range(0); i++) q.push(i);
+    }
+
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        if (r.producer) q.push(++i);
+        if (r.consumer) {
+            q.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_queue<unsigned long> mq_empty, mq_deep;
+void BM_mutex_queue(benchmark::State& state) {
+    producer_consumer(state, mq_empty);
+}
+void BM_mutex_queue_deep(benchmark::State& state) {
+    producer_consumer(state, mq_deep);
+}
+
+two_lock_queue<unsigned long> tq_empty, tq_deep;
+void BM_two_lock_queue(benchmark::State& state) {
+    producer_consumer(state, tq_empty);
+}
+void BM_two_lock_queue_deep(benchmark::State& state) {
+    producer_consumer(state, tq_deep);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_queue)->Arg(0) ARGS;
+BENCHMARK(BM_mutex_queue_deep)->Arg(4096) ARGS;
+BENCHMARK(BM_two_lock_queue)->Arg(0) ARGS;
+BENCHMARK(BM_two_lock_queue_deep)->Arg(4096) ARGS;
+
+BENCHMARK_MAIN();
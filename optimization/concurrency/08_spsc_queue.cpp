@@ -0,0 +1,74 @@
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "spsc_queue.h"
+
+// Ping-pong: thread 0 sends a value over q1 and waits for the echo on q2, thread 1 echoes it back.
+// One iteration is a round trip, i.e. two handoffs.
+template<typename Q>
+void ping_pong(benchmark::State& state, Q& q1, Q& q2) {
+    unsigned long i = 0, value = 0;
+    if (state.thread_index() == 0) {
+        for (auto _ : state) {
+            q1.push(++i);
+            q2.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    else {
+        for (auto _ : state) {
+            q1.wait_and_pop(value);
+            q2.push(value);
+        }
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+// Streaming: thread 0 pushes as fast as it can, thread 1 pops as fast as it can.
+template<typename Q>
+void stream(benchmark::State& state, Q& q) {
+    unsigned long i = 0, value = 0;
+    if (state.thread_index() == 0) {
+        for (auto _ : state) {
+            q.push(++i);
+        }
+    }
+    else {
+        for (auto _ : state) {
+            q.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_queue<unsigned long> mq1, mq2;
+void BM_mutex_ping_pong(benchmark::State& state) {
+    ping_pong(state, mq1, mq2);
+}
+
+spsc_queue<unsigned long> sq1(1024), sq2(1024);
+void BM_spsc_ping_pong(benchmark::State& state) {
+    ping_pong(state, sq1, sq2);
+}
+
+threadsafe_queue<unsigned long> mq;
+void BM_mutex_stream(benchmark::State& state) {
+    stream(state, mq);
+}
+
+spsc_queue<unsigned long> sq(1024);
+void BM_spsc_stream(benchmark::State& state) {
+    stream(state, sq);
+}
+
+#define ARGS \
+    ->Threads(2) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_ping_pong) ARGS;
+BENCHMARK(BM_spsc_ping_pong) ARGS;
+BENCHMARK(BM_mutex_stream) ARGS;
+BENCHMARK(BM_spsc_stream) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "bench_roles.h"
+
+// The original threadsafe_queue blocking path: every push notifies, parked consumer or not.
+template<typename T>
+class cv_queue
+{
+private:
+    std::mutex mutex;
+    std::queue<T> queue;
+    std::condition_variable cond_var;
+    std::atomic<std::size_t> notify_count{0};
+
+public:
+    void push(T value) {
+        std::lock_guard lock(mutex);
+        queue.push(value);
+        notify_count.fetch_add(1, std::memory_order_relaxed);
+        cond_var.notify_one();
+    }
+    void wait_and_pop(T& value) {
+        std::unique_lock lock(mutex);
+        cond_var.wait(lock, [this]() { return !queue.empty(); });
+        value = queue.front();
+        queue.pop();
+    }
+    std::size_t notifications() const {
+        return notify_count.load(std::memory_order_relaxed);
+    }
+};
+
+// Producers do state.range(0) units of busy work between pushes, so with a non-zero
+// argument the consumers run dry and have to park.
+// Reported: wakeups per pop (producer-side notifications) and the p99 wait_and_pop latency.
+template<typename Q>
+void producer_consumer(benchmark::State& state, Q& q) {
+    roles const r(state);
+
+    std::vector<long> latency;
+    if (r.consumer) latency.reserve(state.max_iterations);
+    std::size_t const notified = q.notifications();
+
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        if (r.producer) {
+            for (long k = 0; k < state.range(0); k++) benchmark::DoNotOptimize(k);
+            q.push(++i);
+        }
+        if (r.consumer) {
+            auto const start = std::chrono::steady_clock::now();
+            q.wait_and_pop(value);
+            latency.push_back((std::chrono::steady_clock::now() - start).count());
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (r.consumer && !latency.empty()) {
+        auto p99 = latency.begin() + latency.size() * 99 / 100;
+        std::nth_element(latency.begin(), p99, latency.end());
+        // counters are summed over threads, so this is the mean of the per-consumer p99s
+        state.counters["p99_ns"] = double(*p99) / r.consumers;
+    }
+    if (state.thread_index() == 0) {
+        state.counters["wakeups_per_pop"] =
+            double(q.notifications() - notified) / (double(state.iterations()) * r.consumers);
+    }
+}
+
+cv_queue<unsigned long> cq;
+void BM_notify_always(benchmark::State& state) {
+    producer_consumer(state, cq);
+}
+
+threadsafe_queue<unsigned long> wq;
+void BM_notify_sleepers(benchmark::State& state) {
+    producer_consumer(state, wq);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->Arg(0)->Arg(1000) \
+    ->ThreadRange(2, std::max(2L, numcpu)) \
+    ->UseRealTime()
+
+BENCHMARK(BM_notify_always) ARGS;
+BENCHMARK(BM_notify_sleepers) ARGS;
+
+BENCHMARK_MAIN();
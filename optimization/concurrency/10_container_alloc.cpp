@@ -0,0 +1,167 @@
+#include <unistd.h>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stack>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "threadsafe_stack.h"
+
+#include "count_allocs.h"
+
+// The containers as they were before: copy in, copy out into a fresh shared_ptr.
+template<typename T>
+class legacy_queue
+{
+private:
+    std::mutex mutex;
+    std::queue<T> queue;
+
+public:
+    void push(T value) {
+        std::lock_guard lock(mutex);
+        queue.push(value);
+    }
+    std::shared_ptr<T> try_pop() {
+        std::lock_guard lock(mutex);
+        if (queue.empty()) return std::shared_ptr<T>{};
+        std::shared_ptr<T> ret{std::make_shared<T>(queue.front())};
+        queue.pop();
+        return ret;
+    }
+};
+
+template<typename T>
+class legacy_stack
+{
+private:
+    std::mutex m;
+    std::stack<T> st;
+
+public:
+    void push(T value) {
+        std::lock_guard lock(m);
+        st.push(std::move(value));
+    }
+    std::shared_ptr<T> pop() {
+        std::lock_guard lock(m);
+        if (st.empty()) return std::shared_ptr<T>{};
+        std::shared_ptr<T> const ret(std::make_shared<T>(st.top()));
+        st.pop();
+        return ret;
+    }
+};
+
+// Every thread pushes one element and pops one element per iteration.
+// allocs_per_op counts the allocations of one push + pop pair, including the one
+// needed to build the payload itself (one for a 64-byte string or a unique_ptr).
+void report(benchmark::State& state, unsigned long start) {
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_op"] = benchmark::Counter(
+        double(allocs - start) / state.iterations(), benchmark::Counter::kAvgThreads);
+}
+
+std::string const payload(64, 'x');
+
+legacy_queue<std::string> lq;
+void BM_legacy_queue(benchmark::State& state) {
+    unsigned long const start = allocs;
+    for (auto _ : state) {
+        lq.push(payload);
+        std::shared_ptr<std::string> p;
+        while (!(p = lq.try_pop())) {}
+        benchmark::DoNotOptimize(p->data());
+    }
+    report(state, start);
+}
+
+threadsafe_queue<std::string> q;
+void BM_queue(benchmark::State& state) {
+    unsigned long const start = allocs;
+    for (auto _ : state) {
+        q.push(payload);
+        std::optional<std::string> p;
+        while (!(p = q.try_pop())) {}
+        benchmark::DoNotOptimize(p->data());
+    }
+    report(state, start);
+}
+
+threadsafe_queue<std::string> eq;
+void BM_queue_emplace(benchmark::State& state) {
+    unsigned long const start = allocs;
+    std::string s;
+    for (auto _ : state) {
+        eq.emplace(64, 'x');
+        while (!eq.try_pop(s)) {}
+        benchmark::DoNotOptimize(s.data());
+    }
+    report(state, start);
+}
+
+threadsafe_queue<std::unique_ptr<unsigned long>> uq;
+void BM_queue_unique_ptr(benchmark::State& state) {
+    unsigned long const start = allocs;
+    std::unique_ptr<unsigned long> p;
+    for (auto _ : state) {
+        uq.push(std::make_unique<unsigned long>(42));
+        while (!uq.try_pop(p)) {}
+        benchmark::DoNotOptimize(p.get());
+    }
+    report(state, start);
+}
+
+legacy_stack<std::string> ls;
+void BM_legacy_stack(benchmark::State& state) {
+    unsigned long const start = allocs;
+    for (auto _ : state) {
+        ls.push(payload);
+        std::shared_ptr<std::string> p;
+        while (!(p = ls.pop())) {}
+        benchmark::DoNotOptimize(p->data());
+    }
+    report(state, start);
+}
+
+threadsafe_stack<std::string> st;
+void BM_stack(benchmark::State& state) {
+    unsigned long const start = allocs;
+    for (auto _ : state) {
+        st.push(payload);
+        std::optional<std::string> p;
+        while (!(p = st.try_pop())) {}
+        benchmark::DoNotOptimize(p->data());
+    }
+    report(state, start);
+}
+
+threadsafe_stack<std::unique_ptr<unsigned long>> ust;
+void BM_stack_unique_ptr(benchmark::State& state) {
+    unsigned long const start = allocs;
+    std::unique_ptr<unsigned long> p;
+    for (auto _ : state) {
+        ust.emplace(new unsigned long(42));
+        while (!ust.try_pop(p)) {}
+        benchmark::DoNotOptimize(p.get());
+    }
+    report(state, start);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_legacy_queue) ARGS;
+BENCHMARK(BM_queue) ARGS;
+BENCHMARK(BM_queue_emplace) ARGS;
+BENCHMARK(BM_queue_unique_ptr) ARGS;
+BENCHMARK(BM_legacy_stack) ARGS;
+BENCHMARK(BM_stack) ARGS;
+BENCHMARK(BM_stack_unique_ptr) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <unistd.h>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "multi_queue.h"
+
+// std::priority_queue behind one mutex, smallest priority first
+template<typename T>
+class locked_heap
+{
+private:
+    using entry = std::pair<unsigned long, T>;
+    std::mutex m;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+
+public:
+    void push(unsigned long priority, T value) {
+        std::lock_guard lock(m);
+        heap.emplace(priority, std::move(value));
+    }
+    bool try_pop_min(T& value) {
+        std::lock_guard lock(m);
+        if (heap.empty()) return false;
+        value = heap.top().second;
+        heap.pop();
+        return true;
+    }
+};
+
+// Every thread pushes an element with a pseudo-random priority and pops the (near) minimum
+// once per iteration. The queue is prefilled so pops do not run into an empty queue.
+template<typename Q>
+void push_pop(benchmark::State& state, Q& q, bool& prefilled) {
+    if (state.thread_index() == 0 && !prefilled) {
+        for (unsigned long i = 0; i < 1 << 16; i++) q.push(i * 2654435761u % 1000003, i);
+        prefilled = true;
+    }
+
+    std::uint64_t x = 88172645463325252ull + state.thread_index();
+    unsigned long value = 0;
+    for (auto _ : state) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        q.push(x % 1000003, x);
+        q.try_pop_min(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+locked_heap<unsigned long> lh;
+bool lh_prefilled = false;
+void BM_locked_heap(benchmark::State& state) {
+    push_pop(state, lh, lh_prefilled);
+}
+
+multi_queue<unsigned long> mq;
+bool mq_prefilled = false;
+void BM_multi_queue(benchmark::State& state) {
+    push_pop(state, mq, mq_prefilled);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_locked_heap) ARGS;
+BENCHMARK(BM_multi_queue) ARGS;
+
+BENCHMARK_MAIN();
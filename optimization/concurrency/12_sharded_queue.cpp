@@ -0,0 +1,69 @@
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "sharded_queue.h"
+#include "bench_roles.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// Every thread pushes and pops once per iteration. With the sharded queue both
+// operations normally stay on the thread's own lane.
+template<typename Q>
+void push_pop(benchmark::State& state, Q& q) {
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        q.push(++i);
+        q.wait_and_pop(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Consumers find their own lane empty and have to steal from the producers' lanes.
+template<typename Q>
+void producer_consumer(benchmark::State& state, Q& q) {
+    roles const r(state);
+
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        if (r.producer) q.push(++i);
+        if (r.consumer) {
+            q.wait_and_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_queue<unsigned long> q1;
+void BM_queue_push_pop(benchmark::State& state) {
+    push_pop(state, q1);
+}
+
+sharded_queue<unsigned long> s1(numcpu);
+void BM_sharded_push_pop(benchmark::State& state) {
+    push_pop(state, s1);
+}
+
+threadsafe_queue<unsigned long> q2;
+void BM_queue_producer_consumer(benchmark::State& state) {
+    producer_consumer(state, q2);
+}
+
+sharded_queue<unsigned long> s2(numcpu);
+void BM_sharded_producer_consumer(benchmark::State& state) {
+    producer_consumer(state, s2);
+}
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_queue_push_pop) ARGS;
+BENCHMARK(BM_sharded_push_pop) ARGS;
+BENCHMARK(BM_queue_producer_consumer) ARGS;
+BENCHMARK(BM_sharded_producer_consumer) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,214 @@
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "two_lock_queue.h"
+#include "bounded_queue.h"
+#include "spsc_queue.h"
+#include "sharded_queue.h"
+#include "multi_queue.h"
+#include "lock_free_queue.h"
+#include "flat_combining.h"
+#include "threadsafe_stack.h"
+#include "lock_free_stack.h"
+
+/**
+ * Producer/consumer benchmark suite for the concurrent containers.
+ *
+ * Any container that models push_pop_container can be plugged in (see register_all()).
+ * Every benchmark is one point of the grid
+ *     container x producers x consumers x payload size x burst
+ * and one iteration moves `messages` messages from the producer threads to the consumer
+ * threads. Each message carries its enqueue timestamp, the consumer records the
+ * enqueue-to-dequeue latency, and the run reports items_per_second together with the
+ * p50/p99/p99.9 latency over all messages of all iterations.
+ *
+ * burst = 0: producers push as fast as they can.
+ * burst = b: producers push b messages back-to-back, then idle for b * gap_ns, so every
+ *            burst setting offers the same average load and only the clustering changes.
+ *
+ * Use --benchmark_filter to pick a slice of the grid, e.g. --benchmark_filter='bytes:64/'.
+ */
+
+template<typename Q, typename T>
+concept push_pop_container = std::default_initializable<Q> && requires(Q& q, T v) {
+    q.push(std::move(v));
+    { q.try_pop(v) } -> std::convertible_to<bool>;
+};
+
+template<std::size_t N>
+struct message {
+    static_assert(N >= sizeof(std::int64_t));
+    std::int64_t stamp;
+    std::array<char, N - sizeof(std::int64_t)> data;
+};
+
+// multi_queue pops by priority, ordering by the enqueue timestamp makes it (roughly) FIFO
+template<typename T>
+class fifo_multi_queue
+{
+    multi_queue<T> q;
+
+public:
+    void push(T value) {
+        auto const priority = static_cast<unsigned long>(value.stamp);
+        q.push(priority, std::move(value));
+    }
+    bool try_pop(T& value) {
+        return q.try_pop_min(value);
+    }
+};
+
+template<typename T> using bounded_block_queue = bounded_queue<T, full_policy::block>;
+template<typename T> using elimination_stack = lock_free_stack<T, contention_policy::elimination>;
+
+static constexpr long messages = 1 << 14;
+static constexpr long gap_ns = 200;
+
+static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Q, std::size_t N>
+    requires push_pop_container<Q, message<N>>
+void BM_producer_consumer(benchmark::State& state, int producers, int consumers, long burst) {
+    using msg = message<N>;
+    Q q;
+    std::vector<std::int64_t> samples;
+    samples.reserve(messages * 64);
+
+    for (auto _ : state) {
+        std::atomic<bool> go{false};
+        std::atomic<int> producers_done{0};
+        std::vector<std::vector<std::int64_t>> latency(consumers);
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < producers; p++) {
+            long const count = messages / producers + (p < messages % producers ? 1 : 0);
+            threads.emplace_back([&, count]() {
+                while (!go.load(std::memory_order_acquire)) {}
+                msg m{};
+                for (long i = 0; i < count; ) {
+                    long const n = burst ? std::min(burst, count - i) : count - i;
+                    for (long k = 0; k < n; k++, i++) {
+                        m.stamp = now_ns();
+                        q.push(std::move(m));
+                    }
+                    if (burst) {
+                        std::int64_t const until = now_ns() + burst * gap_ns;
+                        while (now_ns() < until) {}
+                    }
+                }
+                producers_done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        for (int c = 0; c < consumers; c++) {
+            threads.emplace_back([&, c]() {
+                std::vector<std::int64_t>& lat = latency[c];
+                lat.reserve(messages);
+                while (!go.load(std::memory_order_acquire)) {}
+                msg m;
+                for (;;) {
+                    if (q.try_pop(m)) {
+                        lat.push_back(now_ns() - m.stamp);
+                        benchmark::DoNotOptimize(m.data);
+                    }
+                    else if (producers_done.load(std::memory_order_acquire) == producers) {
+                        // every push has completed, one more failed pop means the container is drained
+                        if (!q.try_pop(m)) break;
+                        lat.push_back(now_ns() - m.stamp);
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        auto const start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& t : threads) t.join();
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        state.SetIterationTime(elapsed.count());
+
+        for (auto const& lat : latency) {
+            samples.insert(samples.end(), lat.begin(), lat.end());
+        }
+    }
+    state.SetItemsProcessed(messages * state.iterations());
+    state.SetBytesProcessed(messages * state.iterations() * N);
+
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        return double(samples[std::size_t(p * (samples.size() - 1))]);
+    };
+    state.counters["p50_ns"] = percentile(0.50);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// At most numcpu threads run at once, well within the per-thread records of
+// lock_free_queue (hazard_pointer::max_threads()) and the fc_ wrappers
+// (flat_combining_detail::max_threads()), both 4 per CPU and at least 128.
+template<template<typename> class Q, std::size_t N>
+void register_size(std::string const& name, bool single_producer_consumer) {
+    long const max_threads = std::max(2L, numcpu);
+    for (int p = 1; p < max_threads; p *= 2) {
+        for (int c = 1; p + c <= max_threads; c *= 2) {
+            if (single_producer_consumer && (p != 1 || c != 1)) continue;
+            for (long burst : {0L, 1L, 64L}) {
+                std::string const full = "BM_producer_consumer/" + name + "/p:" + std::to_string(p) + "/c:" +
+                    std::to_string(c) + "/bytes:" + std::to_string(N) + "/burst:" + std::to_string(burst);
+                benchmark::RegisterBenchmark(full.c_str(), BM_producer_consumer<Q<message<N>>, N>, p, c, burst)
+                    ->UseManualTime()
+                    ->Unit(benchmark::kMicrosecond);
+            }
+        }
+    }
+}
+
+template<template<typename> class Q>
+void register_container(std::string const& name, bool single_producer_consumer = false) {
+    register_size<Q, 8>(name, single_producer_consumer);
+    register_size<Q, 64>(name, single_producer_consumer);
+    register_size<Q, 512>(name, single_producer_consumer);
+    register_size<Q, 4096>(name, single_producer_consumer);
+}
+
+void register_all() {
+    register_container<threadsafe_queue>("threadsafe_queue");
+    register_container<two_lock_queue>("two_lock_queue");
+    register_container<bounded_block_queue>("bounded_queue");
+    register_container<sharded_queue>("sharded_queue");
+    register_container<fifo_multi_queue>("multi_queue");
+    register_container<lock_free_queue>("lock_free_queue");
+    register_container<threadsafe_stack>("threadsafe_stack");
+    register_container<lock_free_stack>("lock_free_stack");
+    register_container<elimination_stack>("elimination_stack");
+    register_container<fc_queue>("fc_queue");
+    register_container<fc_stack>("fc_stack");
+    register_container<spsc_queue>("spsc_queue", true);
+}
+
+int main(int argc, char** argv) {
+    register_all();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <unistd.h>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "lock_free_queue.h"
+#include "bench_roles.h"
+
+// Every thread pushes and pops once per iteration.
+template<typename Q>
+void push_pop(benchmark::State& state, Q& q) {
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        q.push(++i);
+        while (!q.try_pop(value)) {}
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Q>
+void producer_consumer(benchmark::State& state, Q& q) {
+    roles const r(state);
+
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        if (r.producer) q.push(++i);
+        if (r.consumer) {
+            while (!q.try_pop(value)) {}
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_queue<unsigned long> mq1;
+void BM_mutex_queue_push_pop(benchmark::State& state) {
+    push_pop(state, mq1);
+}
+
+lock_free_queue<unsigned long> lq1;
+void BM_lock_free_queue_push_pop(benchmark::State& state) {
+    push_pop(state, lq1);
+}
+
+threadsafe_queue<unsigned long> mq2;
+void BM_mutex_queue_producer_consumer(benchmark::State& state) {
+    producer_consumer(state, mq2);
+}
+
+lock_free_queue<unsigned long> lq2;
+void BM_lock_free_queue_producer_consumer(benchmark::State& state) {
+    producer_consumer(state, lq2);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// lock_free_queue claims a hazard pointer record per thread and throws when all
+// hazard_pointer::max_threads() records (4 per CPU, at least 128) are taken.
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_queue_push_pop) ARGS;
+BENCHMARK(BM_lock_free_queue_push_pop) ARGS;
+BENCHMARK(BM_mutex_queue_producer_consumer) ARGS;
+BENCHMARK(BM_lock_free_queue_producer_consumer) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <unistd.h>
+#include <iterator>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_stack.h"
+#include "lock_free_stack.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// Every thread pushes and pops once per iteration, all on the same top.
+template<typename S>
+void push_pop(benchmark::State& state, S& s) {
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        s.push(++i);
+        while (!s.try_pop(value)) {}
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_stack<unsigned long> ms1;
+void BM_mutex_stack_push_pop(benchmark::State& state) {
+    push_pop(state, ms1);
+}
+
+lock_free_stack<unsigned long> ls1;
+void BM_lock_free_stack_push_pop(benchmark::State& state) {
+    push_pop(state, ls1);
+}
+
+// Moves a batch of range(0) elements in and out per iteration: one push_list/pop_all
+// pair for the lock-free stack, element-wise push/try_pop for the mutex stack.
+static void bulk_args(benchmark::internal::Benchmark* b) {
+    b->ArgName("batch")->Arg(8)->Arg(64)->Arg(512);
+}
+
+threadsafe_stack<unsigned long> ms2;
+void BM_mutex_stack_bulk(benchmark::State& state) {
+    std::vector<unsigned long> in(state.range(0), 1), out;
+    out.reserve(in.size() * state.threads());
+    unsigned long value;
+    for (auto _ : state) {
+        for (auto v : in) ms2.push(v);
+        out.clear();
+        while (ms2.try_pop(value)) out.push_back(value);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+lock_free_stack<unsigned long> ls2;
+void BM_lock_free_stack_bulk(benchmark::State& state) {
+    std::vector<unsigned long> in(state.range(0), 1), out;
+    out.reserve(in.size() * state.threads());
+    for (auto _ : state) {
+        ls2.push_list(in.begin(), in.end());
+        out.clear();
+        ls2.pop_all(std::back_inserter(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_stack_push_pop) ARGS;
+BENCHMARK(BM_lock_free_stack_push_pop) ARGS;
+BENCHMARK(BM_mutex_stack_bulk)->Apply(bulk_args) ARGS;
+BENCHMARK(BM_lock_free_stack_bulk)->Apply(bulk_args) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+#include <unistd.h>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_stack.h"
+#include "lock_free_stack.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// Every thread runs a random mix of pushes and non-blocking pops on the same stack;
+// range(0) is the percentage of pushes (50 = symmetric load). Failed pops count as
+// operations, the pop-heavy mix mostly hits an empty stack.
+template<typename S>
+void mixed(benchmark::State& state, S& s) {
+    std::uint32_t rng = 2463534242u + state.thread_index();
+    auto const push_pct = static_cast<std::uint32_t>(state.range(0));
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        if (rng % 100 < push_pct) {
+            s.push(++i);
+        }
+        else {
+            s.try_pop(value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    // keep the push-heavy runs from carrying their surplus into the next run
+    if (state.thread_index() == 0) {
+        while (s.try_pop(value)) {}
+    }
+}
+
+threadsafe_stack<unsigned long> ms;
+void BM_mutex_stack(benchmark::State& state) {
+    mixed(state, ms);
+}
+
+lock_free_stack<unsigned long> ls;
+void BM_lock_free_stack(benchmark::State& state) {
+    mixed(state, ls);
+}
+
+lock_free_stack<unsigned long, contention_policy::elimination> es;
+void BM_elimination_stack(benchmark::State& state) {
+    mixed(state, es);
+}
+
+#define ARGS \
+    ->ArgName("push_pct")->Arg(50)->Arg(30)->Arg(70) \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_stack) ARGS;
+BENCHMARK(BM_lock_free_stack) ARGS;
+BENCHMARK(BM_elimination_stack) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+#include <unistd.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "benchmark/benchmark.h"
+
+#include "threadsafe_queue.h"
+#include "threadsafe_stack.h"
+#include "flat_combining.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// Every thread pushes and pops once per iteration.
+template<typename C>
+void push_pop(benchmark::State& state, C& c) {
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        c.push(++i);
+        c.try_pop(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+threadsafe_stack<unsigned long> ms;
+void BM_mutex_stack(benchmark::State& state) {
+    push_pop(state, ms);
+}
+
+fc_stack<unsigned long> fs;
+void BM_fc_stack(benchmark::State& state) {
+    push_pop(state, fs);
+}
+
+threadsafe_queue<unsigned long> mq;
+void BM_mutex_queue(benchmark::State& state) {
+    push_pop(state, mq);
+}
+
+fc_queue<unsigned long> fq;
+void BM_fc_queue(benchmark::State& state) {
+    push_pop(state, fq);
+}
+
+// The telephone book of shared_lock/main.cpp: one lookup or update of a random key per
+// iteration, one update in ten.
+static constexpr int book_size = 1024;
+
+template<typename Find, typename Update>
+void phone_book(benchmark::State& state, Find find, Update update) {
+    std::uint32_t rng = 2463534242u + state.thread_index();
+    for (auto _ : state) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        int const key = rng % book_size;
+        if (rng % 10 == 0) update(key, static_cast<int>(rng));
+        else benchmark::DoNotOptimize(find(key));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+std::map<int, int> book;
+std::mutex book_mutex;
+void BM_mutex_map(benchmark::State& state) {
+    phone_book(state,
+        [](int key) {
+            std::lock_guard lock(book_mutex);
+            auto const it = book.find(key);
+            return it == book.end() ? 0 : it->second;
+        },
+        [](int key, int value) {
+            std::lock_guard lock(book_mutex);
+            book[key] = value;
+        });
+}
+
+fc_map<int, int> fc_book;
+void BM_fc_map(benchmark::State& state) {
+    phone_book(state,
+        [](int key) { return fc_book.find(key).value_or(0); },
+        [](int key, int value) { fc_book.insert_or_assign(key, value); });
+}
+
+// The fc_ wrappers claim a publication slot per thread and throw when all
+// flat_combining_detail::max_threads() slots (4 per CPU, at least 128) are taken.
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_mutex_stack) ARGS;
+BENCHMARK(BM_fc_stack) ARGS;
+BENCHMARK(BM_mutex_queue) ARGS;
+BENCHMARK(BM_fc_queue) ARGS;
+BENCHMARK(BM_mutex_map) ARGS;
+BENCHMARK(BM_fc_map) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,171 @@
+#include <unistd.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "benchmark/benchmark.h"
+
+#include "node_pool.h"
+#include "threadsafe_queue.h"
+#include "threadsafe_stack.h"
+#include "bench_roles.h"
+
+#include "count_allocs.h"
+
+// allocs_per_op counts the calls to operator new per iteration, averaged over the threads
+void report(benchmark::State& state, unsigned long start) {
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_op"] = benchmark::Counter(
+        double(allocs - start) / state.iterations(), benchmark::Counter::kAvgThreads);
+}
+
+struct node {
+    node* next;
+    char payload[56];
+};
+
+// Every thread keeps a window of live nodes and replaces the oldest one per iteration.
+template<typename Alloc, typename Free>
+void churn(benchmark::State& state, Alloc alloc, Free free) {
+    constexpr std::size_t window = 16;
+    node* live[window] = {};
+    std::size_t i = 0;
+    unsigned long const start = allocs;
+    for (auto _ : state) {
+        if (live[i]) free(live[i]);
+        live[i] = alloc();
+        benchmark::DoNotOptimize(live[i]);
+        i = (i + 1) % window;
+    }
+    for (node* n : live) {
+        if (n) free(n);
+    }
+    report(state, start);
+}
+
+void BM_new_delete(benchmark::State& state) {
+    churn(state, [] { return new node; }, [](node* n) { delete n; });
+}
+
+void BM_pool(benchmark::State& state) {
+    churn(state,
+        [] { return new (fixed_pool<sizeof(node)>::allocate()) node; },
+        [](node* n) { fixed_pool<sizeof(node)>::deallocate(n); });
+}
+
+// Producers (see bench_roles.h) allocate nodes and pass them on, consumers free them:
+// the freeing threads' caches overflow into the global list and the allocating threads
+// refill from there.
+template<typename Alloc, typename Free>
+void cross_thread(benchmark::State& state, threadsafe_queue<node*>& q, Alloc alloc, Free free) {
+    roles const r(state);
+
+    unsigned long const start = allocs;
+    node* n = nullptr;
+    for (auto _ : state) {
+        if (r.producer) q.push(alloc());
+        if (r.consumer) {
+            q.wait_and_pop(n);
+            free(n);
+        }
+    }
+    report(state, start);
+}
+
+threadsafe_queue<node*> handoff1;
+void BM_new_delete_cross_thread(benchmark::State& state) {
+    cross_thread(state, handoff1, [] { return new node; }, [](node* n) { delete n; });
+}
+
+threadsafe_queue<node*> handoff2;
+void BM_pool_cross_thread(benchmark::State& state) {
+    cross_thread(state, handoff2,
+        [] { return new (fixed_pool<sizeof(node)>::allocate()) node; },
+        [](node* n) { fixed_pool<sizeof(node)>::deallocate(n); });
+}
+
+// The containers with the default allocator and with pool_allocator; every thread
+// pushes and pops once per iteration.
+template<typename C>
+void push_pop(benchmark::State& state, C& c) {
+    unsigned long const start = allocs;
+    unsigned long i = 0, value = 0;
+    for (auto _ : state) {
+        c.push(++i);
+        while (!c.try_pop(value)) {}
+        benchmark::DoNotOptimize(value);
+    }
+    report(state, start);
+}
+
+threadsafe_queue<unsigned long> q;
+void BM_queue(benchmark::State& state) {
+    push_pop(state, q);
+}
+
+threadsafe_queue<unsigned long, pool_allocator<unsigned long>> pq;
+void BM_queue_pool(benchmark::State& state) {
+    push_pop(state, pq);
+}
+
+threadsafe_stack<unsigned long> st;
+void BM_stack(benchmark::State& state) {
+    push_pop(state, st);
+}
+
+threadsafe_stack<unsigned long, pool_allocator<unsigned long>> pst;
+void BM_stack_pool(benchmark::State& state) {
+    push_pop(state, pst);
+}
+
+// A mutex-protected std::map, one insert and one erase per iteration.
+template<typename Map>
+void map_insert_erase(benchmark::State& state, Map& m, std::mutex& mutex) {
+    unsigned long const start = allocs;
+    int key = state.thread_index() << 20;
+    for (auto _ : state) {
+        {
+            std::lock_guard lock(mutex);
+            m.emplace(key, key);
+        }
+        {
+            std::lock_guard lock(mutex);
+            m.erase(key);
+        }
+        ++key;
+    }
+    report(state, start);
+}
+
+std::map<int, int> m;
+std::mutex m_mutex;
+void BM_map(benchmark::State& state) {
+    map_insert_erase(state, m, m_mutex);
+}
+
+std::map<int, int, std::less<int>, pool_allocator<std::pair<int const, int>>> pm;
+std::mutex pm_mutex;
+void BM_map_pool(benchmark::State& state) {
+    map_insert_erase(state, pm, pm_mutex);
+}
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK(BM_new_delete) ARGS;
+BENCHMARK(BM_pool) ARGS;
+BENCHMARK(BM_new_delete_cross_thread) ARGS;
+BENCHMARK(BM_pool_cross_thread) ARGS;
+BENCHMARK(BM_queue) ARGS;
+BENCHMARK(BM_queue_pool) ARGS;
+BENCHMARK(BM_stack) ARGS;
+BENCHMARK(BM_stack_pool) ARGS;
+BENCHMARK(BM_map) ARGS;
+BENCHMARK(BM_map_pool) ARGS;
+
+BENCHMARK_MAIN();
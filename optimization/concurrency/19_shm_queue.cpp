@@ -0,0 +1,171 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "shm_queue.h"
+
+/**
+ * Two-process transfer: the benchmark process sends `batch` messages per iteration to
+ * a forked child, the child acknowledges every batch with one message carrying the
+ * send-to-receive latency it measured. batch = 1 is a ping-pong (iteration time is the
+ * round trip), larger batches measure streaming throughput.
+ *
+ * The same exchange runs over a pair of shm_queues and over a pair of pipes.
+ */
+template<std::size_t N>
+struct message {
+    static_assert(N >= sizeof(std::int64_t));
+    std::int64_t stamp; // < 0 tells the child to exit
+    std::array<char, N - sizeof(std::int64_t)> data;
+};
+
+struct ack {
+    std::int64_t latency_sum;
+    std::int64_t latency_max;
+};
+
+static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<std::size_t N>
+class shm_channel
+{
+private:
+    std::string const data_name = "/practice_cpp_shm_queue_data_" + std::to_string(getpid());
+    std::string const ack_name = "/practice_cpp_shm_queue_ack_" + std::to_string(getpid());
+    shm_queue<message<N>> data = shm_queue<message<N>>::create(data_name, 1024);
+    shm_queue<ack> acks = shm_queue<ack>::create(ack_name, 16);
+
+public:
+    ~shm_channel() {
+        shm_queue<message<N>>::unlink(data_name);
+        shm_queue<ack>::unlink(ack_name);
+    }
+
+    // the child maps the segments again by name, as an unrelated process would
+    void attach() {
+        data = shm_queue<message<N>>::open(data_name);
+        acks = shm_queue<ack>::open(ack_name);
+    }
+
+    void send(message<N> const& m) { data.push(m); }
+    void receive(message<N>& m) { data.wait_and_pop(m); }
+    void send_ack(ack const& a) { acks.push(a); }
+    void receive_ack(ack& a) { acks.wait_and_pop(a); }
+};
+
+template<std::size_t N>
+class pipe_channel
+{
+private:
+    int data[2];
+    int acks[2];
+
+    static void write_all(int fd, void const* p, std::size_t n) {
+        auto const* c = static_cast<char const*>(p);
+        while (n) {
+            ssize_t const r = write(fd, c, n);
+            if (r <= 0) throw std::system_error(errno, std::generic_category(), "write");
+            c += r;
+            n -= static_cast<std::size_t>(r);
+        }
+    }
+    static void read_all(int fd, void* p, std::size_t n) {
+        auto* c = static_cast<char*>(p);
+        while (n) {
+            ssize_t const r = read(fd, c, n);
+            if (r <= 0) throw std::system_error(errno, std::generic_category(), "read");
+            c += r;
+            n -= static_cast<std::size_t>(r);
+        }
+    }
+
+public:
+    pipe_channel() {
+        if (pipe(data) != 0 || pipe(acks) != 0) throw std::system_error(errno, std::generic_category(), "pipe");
+    }
+    ~pipe_channel() {
+        for (int fd : {data[0], data[1], acks[0], acks[1]}) close(fd);
+    }
+
+    void attach() {}
+
+    void send(message<N> const& m) { write_all(data[1], &m, sizeof(m)); }
+    void receive(message<N>& m) { read_all(data[0], &m, sizeof(m)); }
+    void send_ack(ack const& a) { write_all(acks[1], &a, sizeof(a)); }
+    void receive_ack(ack& a) { read_all(acks[0], &a, sizeof(a)); }
+};
+
+template<std::size_t N, typename Channel>
+[[noreturn]] void child(Channel& ch, long batch) {
+    ch.attach();
+    message<N> m;
+    ack a{0, 0};
+    long received = 0;
+    for (;;) {
+        ch.receive(m);
+        if (m.stamp < 0) break;
+        std::int64_t const latency = now_ns() - m.stamp;
+        a.latency_sum += latency;
+        a.latency_max = std::max(a.latency_max, latency);
+        if (++received == batch) {
+            ch.send_ack(a);
+            a = ack{0, 0};
+            received = 0;
+        }
+    }
+    _exit(0);
+}
+
+template<template<std::size_t> class Channel, std::size_t N>
+void BM_transfer(benchmark::State& state) {
+    long const batch = state.range(0);
+    Channel<N> ch;
+
+    pid_t const pid = fork();
+    if (pid < 0) {
+        state.SkipWithError("fork failed");
+        return;
+    }
+    if (pid == 0) child<N>(ch, batch);
+
+    message<N> m{};
+    ack a;
+    double latency_sum = 0, latency_max = 0;
+    for (auto _ : state) {
+        for (long i = 0; i < batch; i++) {
+            m.stamp = now_ns();
+            ch.send(m);
+        }
+        ch.receive_ack(a);
+        latency_sum += a.latency_sum;
+        latency_max = std::max(latency_max, double(a.latency_max));
+    }
+    m.stamp = -1;
+    ch.send(m);
+    waitpid(pid, nullptr, 0);
+
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * N);
+    state.counters["latency_avg_ns"] = latency_sum / (state.iterations() * batch);
+    state.counters["latency_max_ns"] = latency_max;
+}
+
+#define ARGS \
+    ->ArgName("batch")->Arg(1)->Arg(256) \
+    ->UseRealTime()
+
+BENCHMARK_TEMPLATE(BM_transfer, shm_channel, 64) ARGS;
+BENCHMARK_TEMPLATE(BM_transfer, pipe_channel, 64) ARGS;
+BENCHMARK_TEMPLATE(BM_transfer, shm_channel, 4096) ARGS;
+BENCHMARK_TEMPLATE(BM_transfer, pipe_channel, 4096) ARGS;
+
+BENCHMARK_MAIN();
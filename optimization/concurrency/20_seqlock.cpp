@@ -0,0 +1,107 @@
+#include <unistd.h>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+
+#include "benchmark/benchmark.h"
+
+#include "seqlock.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// MyInt-style value object (immutable_user_defined_type) and a cache-line sized
+// snapshot. Writers keep the elements summing to zero, so a reader that sees a
+// non-zero sum caught a torn snapshot.
+struct pair_snapshot {
+    int my_val1;
+    int my_val2;
+
+    int sum() const { return my_val1 + my_val2; }
+    static pair_snapshot make(int i) { return {i, -i}; }
+};
+
+struct line_snapshot {
+    std::array<long, 8> v;
+
+    long sum() const {
+        long s = 0;
+        for (long x : v) s += x;
+        return s;
+    }
+    static line_snapshot make(int i) {
+        line_snapshot s;
+        for (std::size_t k = 0; k < s.v.size(); k++) s.v[k] = (k % 2 ? -i : i);
+        return s;
+    }
+};
+
+// Every thread reads the snapshot; one read in write_every is a write instead.
+static constexpr long write_every = 10000;
+
+template<typename Read, typename Write>
+void read_mostly(benchmark::State& state, Read read, Write write) {
+    long i = state.thread_index() * 7919, torn = 0;
+    for (auto _ : state) {
+        if (++i % write_every == 0) {
+            write(static_cast<int>(i));
+        }
+        else {
+            auto const s = read();
+            torn += s.sum() != 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["torn"] = double(torn);
+}
+
+template<typename T>
+void BM_seqlock(benchmark::State& state) {
+    static seqlock<T> sl{T::make(0)};
+    read_mostly(state,
+        [] { return sl.load(); },
+        [](int i) { sl.store(T::make(i)); });
+}
+
+// the reader-writer lock of shared_lock/main.cpp
+template<typename T>
+void BM_shared_timed_mutex(benchmark::State& state) {
+    static T value = T::make(0);
+    static std::shared_timed_mutex m;
+    read_mostly(state,
+        [] {
+            std::shared_lock lock(m);
+            return value;
+        },
+        [](int i) {
+            std::lock_guard lock(m);
+            value = T::make(i);
+        });
+}
+
+template<typename T>
+void BM_shared_mutex(benchmark::State& state) {
+    static T value = T::make(0);
+    static std::shared_mutex m;
+    read_mostly(state,
+        [] {
+            std::shared_lock lock(m);
+            return value;
+        },
+        [](int i) {
+            std::lock_guard lock(m);
+            value = T::make(i);
+        });
+}
+
+#define ARGS \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK_TEMPLATE(BM_seqlock, pair_snapshot) ARGS;
+BENCHMARK_TEMPLATE(BM_shared_timed_mutex, pair_snapshot) ARGS;
+BENCHMARK_TEMPLATE(BM_shared_mutex, pair_snapshot) ARGS;
+BENCHMARK_TEMPLATE(BM_seqlock, line_snapshot) ARGS;
+BENCHMARK_TEMPLATE(BM_shared_timed_mutex, line_snapshot) ARGS;
+BENCHMARK_TEMPLATE(BM_shared_mutex, line_snapshot) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,56 @@
+#include <unistd.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "brlock.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// The telephone book of shared_lock/main.cpp: readers look a name up under a shared
+// lock, writers update an entry under an exclusive lock. range(0) is the number of
+// reads per 1000 operations.
+static std::map<std::string, int> make_book() {
+    std::map<std::string, int> book;
+    for (int i = 0; i < 64; i++) book["name" + std::to_string(i)] = 1900 + i;
+    return book;
+}
+
+static std::string const names[] = {"name3", "name17", "name42", "name63"};
+
+template<typename Mutex>
+void BM_tele_book(benchmark::State& state) {
+    static std::map<std::string, int> book = make_book();
+    static Mutex m;
+
+    long const reads_per_1000 = state.range(0);
+    std::uint32_t i = static_cast<std::uint32_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::string const& name = names[i % 4];
+        if (static_cast<long>(i++ % 1000) < reads_per_1000) {
+            std::shared_lock lock(m);
+            auto const it = book.find(name);
+            benchmark::DoNotOptimize(it == book.end() ? 0 : it->second);
+        }
+        else {
+            std::lock_guard lock(m);
+            book[name] = static_cast<int>(i);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define ARGS \
+    ->ArgName("reads_per_1000")->Arg(990)->Arg(999)->Arg(1000) \
+    ->ThreadRange(1, numcpu) \
+    ->UseRealTime()
+
+BENCHMARK_TEMPLATE(BM_tele_book, std::shared_timed_mutex) ARGS;
+BENCHMARK_TEMPLATE(BM_tele_book, std::shared_mutex) ARGS;
+BENCHMARK_TEMPLATE(BM_tele_book, brlock) ARGS;
+
+BENCHMARK_MAIN();
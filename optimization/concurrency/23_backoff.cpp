@@ -0,0 +1,104 @@
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "benchmark/benchmark.h"
+
+#include "backoff.h"
+#include "spin_lock.h"
+
+static const long numcpu = sysconf(_SC_NPROCESSORS_CONF);
+
+// Per-thread log2 histograms of the time lock() took. Every thread clears its own
+// histogram before the benchmark loop and fills it inside; after the loop all threads
+// have passed the end barrier, so thread 0 can merge them. Runs with more than
+// max_threads threads are skipped.
+class WaitLatency {
+public:
+    static constexpr int max_threads = 1024;
+
+    explicit WaitLatency(benchmark::State& state) : state_(state) {
+        if (state.threads() > max_threads) {
+            state.SkipWithError("WaitLatency supports at most 1024 threads");
+            return;
+        }
+        hist_ = &hists_[state.thread_index()];
+        for (auto& n : hist_->n) n = 0;
+    }
+    void record(std::chrono::steady_clock::duration d) {
+        auto const ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+        int const b = ns ? 64 - __builtin_clzll(ns) : 0; // bucket b holds [2^(b-1), 2^b) ns
+        ++hist_->n[b < buckets ? b : buckets - 1];
+    }
+    void report() {
+        if (state_.thread_index() != 0 || !hist_) return;
+        std::uint64_t total[buckets] = {};
+        std::uint64_t count = 0;
+        for (int t = 0; t < state_.threads(); ++t) {
+            for (int b = 0; b < buckets; ++b) {
+                total[b] += hists_[t].n[b];
+                count += hists_[t].n[b];
+            }
+        }
+        state_.counters["p50_ns"] = percentile(total, count, 0.5);
+        state_.counters["p99_ns"] = percentile(total, count, 0.99);
+        state_.counters["p999_ns"] = percentile(total, count, 0.999);
+    }
+
+private:
+    static constexpr int buckets = 40;
+    struct alignas(64) Hist { std::uint64_t n[buckets]; };
+    static Hist hists_[max_threads];
+
+    // upper bound of the bucket that holds the p-th percentile
+    static double percentile(std::uint64_t const* hist, std::uint64_t count, double p) {
+        auto const target = static_cast<std::uint64_t>(p * double(count));
+        std::uint64_t seen = 0;
+        for (int b = 0; b < buckets; ++b) {
+            seen += hist[b];
+            if (seen > target) return double(std::uint64_t(1) << b);
+        }
+        return double(std::uint64_t(1) << (buckets - 1));
+    }
+
+    benchmark::State& state_;
+    Hist* hist_ = nullptr;
+};
+WaitLatency::Hist WaitLatency::hists_[WaitLatency::max_threads];
+
+// A test-and-set lock with each backoff policy. range(0) increments in the critical
+// section; the time to acquire the lock is recorded, including the timer overhead
+// (two clock reads, about 20-50ns).
+template<typename Backoff>
+void BM_backoff(benchmark::State& state) {
+    static BasicSpinLock<Backoff> lock;
+    static unsigned long x = 0;
+
+    long const critical = state.range(0);
+    WaitLatency latency(state);
+    for (auto _ : state) {
+        auto const start = std::chrono::steady_clock::now();
+        std::lock_guard<BasicSpinLock<Backoff>> L(lock);
+        latency.record(std::chrono::steady_clock::now() - start);
+        for (long j = 0; j < critical; ++j) benchmark::DoNotOptimize(++x);
+    }
+    latency.report();
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define ARGS \
+    ->ArgName("critical")->Arg(1)->Arg(64) \
+    ->ThreadRange(1, numcpu) \
+    ->Threads(2 * numcpu) \
+    ->Threads(4 * numcpu) \
+    ->UseRealTime()
+
+BENCHMARK_TEMPLATE(BM_backoff, NoBackoff) ARGS;
+BENCHMARK_TEMPLATE(BM_backoff, SleepBackoff) ARGS;
+BENCHMARK_TEMPLATE(BM_backoff, ExponentialBackoff) ARGS;
+BENCHMARK_TEMPLATE(BM_backoff, RandomizedBackoff) ARGS;
+BENCHMARK_TEMPLATE(BM_backoff, YieldBackoff) ARGS;
+BENCHMARK_TEMPLATE(BM_backoff, FutexBackoff) ARGS;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,21 @@
+#pragma once
+#include "benchmark/benchmark.h"
+
+// Thread roles of the producer/consumer benchmarks: even threads produce, odd threads
+// consume. With an odd number of threads the last thread does both, so that every run
+// pushes and pops the same number of items and the queue is empty again when the next
+// run starts.
+struct roles {
+    bool producer;
+    bool consumer;
+    int consumers; // number of consuming threads
+
+    explicit roles(benchmark::State const& state) {
+        int const idx = state.thread_index();
+        int const threads = state.threads();
+        bool const both = (threads % 2 == 1) && (idx == threads - 1);
+        producer = both || idx % 2 == 0;
+        consumer = both || idx % 2 == 1;
+        consumers = threads / 2 + threads % 2;
+    }
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new/delete so that every allocation made by the calling
+// thread is counted in `allocs`. Replacement functions cannot be inline, so include this
+// from the one source file of a benchmark only.
+// (noinline keeps gcc from pairing the inlined malloc/free with new/delete and warning about it)
+thread_local unsigned long allocs = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t n) {
+    ++allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
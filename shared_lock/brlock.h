@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * Big-reader lock: a distributed reader-writer lock for read-mostly data.
+ *
+ * std::shared_mutex keeps one reader count, so every lock_shared() is an atomic RMW on
+ * the same cache line and reads stop scaling after a few cores even without writers.
+ * brlock gives every thread a cache-line padded reader slot (threads are assigned to
+ * slots round-robin; with more threads than slots a few threads share one). A reader
+ * only increments and decrements its own slot and reads the writer flag, which stays
+ * in every reader's cache as long as no writer comes along.
+ *
+ * A writer takes the writer mutex, raises the writer flag and then sweeps all slots,
+ * waiting for each to drain. A reader that finds the flag raised backs out of its slot
+ * and waits for the writer to finish, so writers are not starved by a stream of readers.
+ * Writes cost O(slots) and are meant to be rare.
+ *
+ * Meets SharedLockable (lock_shared/try_lock_shared/unlock_shared) and Lockable, so it
+ * works with std::shared_lock, std::lock_guard and std::unique_lock. A thread must
+ * release a shared lock on the thread that acquired it.
+ */
+class brlock
+{
+private:
+    static constexpr std::size_t cache_line = 64;
+    static constexpr int spin_count = 64;
+
+    struct alignas(cache_line) slot {
+        std::atomic<int> readers{0};
+    };
+
+    std::unique_ptr<slot[]> const slots;
+    std::size_t const n;
+    alignas(cache_line) std::atomic<bool> writer{false};
+    std::mutex writer_mutex;
+
+    slot& own_slot() const {
+        static std::atomic<std::size_t> next{0};
+        thread_local std::size_t const index = next.fetch_add(1, std::memory_order_relaxed);
+        return slots[index % n];
+    }
+
+    template<typename Done>
+    static void wait_until(Done done) {
+        for (int i = 0; !done(); i++) {
+            if (i >= spin_count) std::this_thread::yield();
+        }
+    }
+
+public:
+    explicit brlock(std::size_t num_slots = std::max(1u, std::thread::hardware_concurrency()))
+        : slots{new slot[std::max<std::size_t>(1, num_slots)]}, n{std::max<std::size_t>(1, num_slots)} {}
+    brlock(brlock const&) = delete;
+    brlock& operator=(brlock const&) = delete;
+
+    bool try_lock_shared() {
+        slot& s = own_slot();
+        // seq_cst on both sides: either the writer sees our count or we see its flag
+        s.readers.fetch_add(1);
+        if (!writer.load()) return true;
+        s.readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void lock_shared() {
+        while (!try_lock_shared()) {
+            wait_until([this] { return !writer.load(std::memory_order_relaxed); });
+        }
+    }
+
+    void unlock_shared() {
+        own_slot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock() {
+        writer_mutex.lock();
+        writer.store(true);
+        for (std::size_t i = 0; i < n; i++) {
+            std::atomic<int>& readers = slots[i].readers;
+            wait_until([&readers] { return readers.load() == 0; });
+        }
+    }
+
+    bool try_lock() {
+        if (!writer_mutex.try_lock()) return false;
+        writer.store(true);
+        for (std::size_t i = 0; i < n; i++) {
+            if (slots[i].readers.load() != 0) {
+                writer.store(false, std::memory_order_release);
+                writer_mutex.unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock() {
+        writer.store(false, std::memory_order_release);
+        writer_mutex.unlock();
+    }
+
+    std::size_t slot_count() const {
+        return n;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Sequence lock for small, trivially copyable snapshots that are read far more often
+ * than written.
+ *
+ * A reader-writer lock makes every reader write to the lock word, so readers on
+ * different cores still bounce its cache line between them. With a seqlock, readers
+ * never write shared memory: a reader reads the sequence number, copies the value and
+ * reads the sequence number again. An odd sequence number means a write is in progress,
+ * and a different second read means a write happened in between; in both cases the
+ * reader retries. Writers are serialized by a mutex and bump the sequence number before
+ * and after changing the value.
+ *
+ * The value is stored as an array of relaxed atomic words, so the racy copy a reader
+ * may make while a writer is active is not a data race, the fences order it against the
+ * sequence number (Boehm, "Can Seqlocks Get Along With Programming Language Memory
+ * Models?", 2012).
+ *
+ * Readers can starve under a continuous stream of writes, so keep writes rare and T small.
+ */
+template<typename T>
+class seqlock
+{
+private:
+    static_assert(std::is_trivially_copyable_v<T>, "seqlock copies T byte-wise");
+
+    using word = std::uint64_t;
+    static constexpr std::size_t words = (sizeof(T) + sizeof(word) - 1) / sizeof(word);
+
+    std::atomic<unsigned> seq{0};
+    std::atomic<word> data[words];
+    std::mutex write_mutex;
+
+    void write(T const& value) {
+        word buf[words] = {};
+        std::memcpy(buf, &value, sizeof(T));
+
+        unsigned const s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < words; i++) data[i].store(buf[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+public:
+    seqlock() : seqlock(T{}) {}
+    explicit seqlock(T const& value) {
+        word buf[words] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        for (std::size_t i = 0; i < words; i++) data[i].store(buf[i], std::memory_order_relaxed);
+    }
+    seqlock(seqlock const&) = delete;
+    seqlock& operator=(seqlock const&) = delete;
+
+    T load() const {
+        word buf[words];
+        for (;;) {
+            unsigned const s1 = seq.load(std::memory_order_acquire);
+            if (s1 & 1) {
+                std::this_thread::yield(); // a writer is active
+                continue;
+            }
+            for (std::size_t i = 0; i < words; i++) buf[i] = data[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s1) break;
+        }
+        T ret;
+        std::memcpy(&ret, buf, sizeof(T));
+        return ret;
+    }
+
+    void store(T const& value) {
+        std::lock_guard lock(write_mutex);
+        write(value);
+    }
+
+    // read-modify-write: f gets a copy of the current value and returns the new one
+    template<typename F>
+    void update(F f) {
+        std::lock_guard lock(write_mutex);
+        write(f(load()));
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Bounded multi-producer/multi-consumer queue (Dmitry Vyukov's algorithm).
+ *
+ * The queue is a power-of-two ring of cells. Each cell carries a sequence number
+ * which tells a thread whether the cell is ready to be written (seq == pos) or
+ * read (seq == pos + 1). A producer claims a position with a CAS on enqueue_pos,
+ * constructs the element in place and publishes it by storing pos + 1. A consumer
+ * claims with a CAS on dequeue_pos, moves the element out and hands the cell back
+ * to the producers by storing pos + capacity.
+ *
+ * All cells are allocated in the constructor; push and pop never allocate.
+ * What happens when the ring is full is selected by the FullPolicy:
+ * - full_policy::block : push() waits until a slot is free and always returns true.
+ * - full_policy::fail  : push() returns false immediately and drops the value.
+ */
+enum class full_policy { block, fail };
+
+template<typename T, full_policy FullPolicy = full_policy::block>
+class bounded_queue
+{
+private:
+    struct cell {
+        std::atomic<std::size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    std::unique_ptr<cell[]> const buffer;
+    std::size_t const mask;
+    alignas(cache_line) std::atomic<std::size_t> enqueue_pos{0};
+    alignas(cache_line) std::atomic<std::size_t> dequeue_pos{0};
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t cap = 2;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    static void wait(int& spins) {
+        if (++spins < 64) return;
+        spins = 0;
+        std::this_thread::yield();
+    }
+
+    template<typename U>
+    bool enqueue(U&& value) {
+        cell* c;
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &buffer[pos & mask];
+            std::size_t const seq = c->seq.load(std::memory_order_acquire);
+            std::intptr_t const diff = std::intptr_t(seq) - std::intptr_t(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (&c->storage) T(std::forward<U>(value));
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T& value) {
+        cell* c;
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &buffer[pos & mask];
+            std::size_t const seq = c->seq.load(std::memory_order_acquire);
+            std::intptr_t const diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* p = std::launder(reinterpret_cast<T*>(&c->storage));
+        value = std::move(*p);
+        p->~T();
+        c->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+public:
+    // capacity is rounded up to the next power of two
+    explicit bounded_queue(std::size_t capacity = 1024)
+        : buffer{new cell[round_up_pow2(capacity)]}, mask{round_up_pow2(capacity) - 1} {
+        for (std::size_t i = 0; i <= mask; i++) {
+            buffer[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    bounded_queue(bounded_queue const&) = delete;
+    bounded_queue& operator=(bounded_queue const&) = delete;
+
+    ~bounded_queue() {
+        std::size_t const end = enqueue_pos.load(std::memory_order_relaxed);
+        for (std::size_t pos = dequeue_pos.load(std::memory_order_relaxed); pos != end; pos++) {
+            std::launder(reinterpret_cast<T*>(&buffer[pos & mask].storage))->~T();
+        }
+    }
+
+    bool push(T value) {
+        if constexpr (FullPolicy == full_policy::fail) {
+            return enqueue(std::move(value));
+        }
+        else {
+            for (int spins = 0; !enqueue(std::move(value)); wait(spins)) {}
+            return true;
+        }
+    }
+
+    bool try_push(T value) {
+        return enqueue(std::move(value));
+    }
+
+    void wait_and_pop(T& value) {
+        for (int spins = 0; !dequeue(value); wait(spins)) {}
+    }
+
+    bool try_pop(T& value) {
+        return dequeue(value);
+    }
+
+    // only a snapshot; other threads may push or pop right after it is taken
+    bool empty() const {
+        return dequeue_pos.load(std::memory_order_acquire) == enqueue_pos.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {
+        return mask + 1;
+    }
+};
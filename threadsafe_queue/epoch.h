@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * Minimal epoch-based reclamation domain (Fraser, 2004).
+ *
+ * A global epoch counter advances only when every thread inside a critical region has
+ * seen the current epoch. A reader wraps its accesses to shared pointers in an
+ * epoch::guard, which announces the epoch it entered in. A writer unlinks an object
+ * and retires it: the object goes on the writer's retire list tagged with the current
+ * epoch and is freed once the global epoch is two ahead, when no reader that might
+ * still see it can be inside a region any more.
+ *
+ * Compared to hazard pointers, the per-read cost is zero: a reader pays one store and
+ * a fence on entering a region and one store on leaving it, however many pointers it
+ * reads inside. The price is that one reader stuck in a region holds back all frees.
+ *
+ * Records are claimed lazily by the first epoch operation of a thread and released
+ * when the thread exits; what the thread retired but could not free yet moves to a
+ * shared orphan list that other threads free later. Whatever is still on that list at
+ * program exit is freed by its static destructor. There are max_threads() records,
+ * 4 per hardware thread but at least 128; a thread that finds none free throws
+ * std::runtime_error. Advancing the epoch only scans up to the highest record ever
+ * claimed.
+ */
+namespace epoch {
+
+constexpr std::size_t retire_batch = 64; // retires between attempts to advance and free
+
+struct retired {
+    void* p;
+    void (*deleter)(void*);
+    std::uint64_t epoch;
+};
+
+// state: the epoch the thread entered in, shifted left by one, | 1 while inside a region
+struct alignas(64) record {
+    std::atomic<bool> active{false};
+    std::atomic<std::uint64_t> state{0};
+};
+
+inline std::atomic<std::uint64_t> global_epoch{0};
+inline std::size_t max_threads() {
+    static std::size_t const n = std::max<std::size_t>(128, 4 * std::size_t(std::thread::hardware_concurrency()));
+    return n;
+}
+
+// never freed, exiting threads may still release their records during static destruction
+inline record* records() {
+    static record* const r = new record[max_threads()];
+    return r;
+}
+
+inline std::atomic<std::size_t> records_in_use{0}; // high-water mark of claimed records
+
+// Runs after the thread_local destructors of the main thread and after the other
+// threads were joined, so no thread can be inside a region any more.
+struct orphan_list {
+    std::mutex mutex;
+    std::vector<retired> list;
+
+    ~orphan_list() {
+        for (retired& r : list) r.deleter(r.p);
+    }
+};
+
+inline orphan_list orphans;
+
+// frees the entries retired at least two epochs before `current`, keeps the rest
+inline void free_expired(std::vector<retired>& list, std::uint64_t current) {
+    std::size_t kept = 0;
+    for (retired& r : list) {
+        if (r.epoch + 2 <= current) r.deleter(r.p);
+        else list[kept++] = r;
+    }
+    list.resize(kept);
+}
+
+// Advances the global epoch if every thread inside a region entered in the current one.
+inline std::uint64_t try_advance() {
+    std::uint64_t e = global_epoch.load();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::size_t const n = records_in_use.load();
+    for (std::size_t i = 0; i < n; i++) {
+        record const& rec = records()[i];
+        if (!rec.active.load(std::memory_order_acquire)) continue;
+        std::uint64_t const s = rec.state.load(std::memory_order_acquire);
+        if ((s & 1) && (s >> 1) != e) return e;
+    }
+    global_epoch.compare_exchange_strong(e, e + 1); // on failure e is the newer epoch
+    return global_epoch.load();
+}
+
+class thread_record
+{
+private:
+    record* r = nullptr;
+    std::size_t depth = 0;
+    std::vector<retired> list;
+
+public:
+    thread_record() {
+        for (std::size_t i = 0; i < max_threads(); i++) {
+            record& rec = records()[i];
+            bool expected = false;
+            if (!rec.active.load(std::memory_order_relaxed) &&
+                rec.active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                // before the thread enters a region, so try_advance() covers the record
+                std::size_t n = records_in_use.load();
+                while (n < i + 1 && !records_in_use.compare_exchange_weak(n, i + 1)) {}
+                r = &rec;
+                return;
+            }
+        }
+        throw std::runtime_error("no free epoch record");
+    }
+    ~thread_record() {
+        r->state.store(0, std::memory_order_release);
+        r->active.store(false, std::memory_order_release);
+        free_expired(list, try_advance());
+        if (!list.empty()) {
+            std::lock_guard lock(orphans.mutex);
+            orphans.list.insert(orphans.list.end(), list.begin(), list.end());
+        }
+    }
+    thread_record(thread_record const&) = delete;
+    thread_record& operator=(thread_record const&) = delete;
+
+    void enter() {
+        if (depth++ != 0) return;
+        r->state.store(global_epoch.load() << 1 | 1, std::memory_order_relaxed);
+        // the announcement must be visible before the region reads any shared pointer
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void exit() {
+        if (--depth != 0) return;
+        r->state.store(0, std::memory_order_release);
+    }
+
+    void retire(void* p, void (*deleter)(void*)) {
+        list.push_back(retired{p, deleter, global_epoch.load()});
+        if (list.size() % retire_batch == 0) collect(1);
+    }
+
+    void collect(int advances) {
+        std::uint64_t e = global_epoch.load();
+        for (int i = 0; i < advances; i++) e = try_advance();
+        free_expired(list, e);
+        std::unique_lock lock(orphans.mutex, std::try_to_lock);
+        if (lock.owns_lock() && !orphans.list.empty()) free_expired(orphans.list, e);
+    }
+};
+
+inline thread_record& this_thread() {
+    thread_local thread_record r;
+    return r;
+}
+
+// Marks a critical region: pointers loaded inside stay valid until the guard is
+// destroyed, even if they are retired meanwhile. Guards nest.
+class guard
+{
+public:
+    guard() { this_thread().enter(); }
+    ~guard() { this_thread().exit(); }
+    guard(guard const&) = delete;
+    guard& operator=(guard const&) = delete;
+};
+
+// Deletes p once no thread can be reading it any more. p must already be unreachable
+// for threads that enter a region from now on.
+template<typename T>
+void retire(T* p) {
+    this_thread().retire(p, [](void* q) { delete static_cast<T*>(q); });
+}
+
+// Frees what this thread retired without waiting for the next batch; everything is
+// freed unless another thread is inside a region that it entered before the call.
+inline void collect() {
+    this_thread().collect(2);
+}
+
+}
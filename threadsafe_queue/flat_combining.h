@@ -0,0 +1,277 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stack>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Flat combining (Hendler, Incze, Shavit and Tzafrir, 2010) for sequential containers.
+ *
+ * Instead of every thread taking the lock and touching the container itself, a thread
+ * publishes its operation in its own publication record and tries to become the
+ * combiner. The combiner runs the pending operations of all threads in one pass while
+ * the other threads spin on their own record until their operation was done for them.
+ * The container and the lock stay in the combiner's cache for the whole batch, so one
+ * lock acquisition serves many operations instead of bouncing between cores for each.
+ *
+ * flat_combining<Container> wraps any sequential container: apply(f) runs f(container)
+ * exclusively and returns its result; exceptions thrown by f are rethrown in the
+ * calling thread. fc_stack, fc_queue and fc_map below are small adapters that give the
+ * wrapped std containers the interface of threadsafe_stack and threadsafe_queue.
+ *
+ * Publication records are indexed by a per-thread slot that is claimed on first use
+ * and released at thread exit, so at most max_threads() threads, 4 per hardware thread
+ * but at least 128, may use the wrappers at the same time; the next one throws
+ * std::runtime_error. Combiners only scan up to the highest slot ever claimed.
+ */
+namespace flat_combining_detail {
+
+inline std::size_t max_threads() {
+    static std::size_t const n = std::max<std::size_t>(128, 4 * std::size_t(std::thread::hardware_concurrency()));
+    return n;
+}
+
+// never freed, exiting threads may still release their slots during static destruction
+inline std::atomic<bool>* claimed() {
+    static std::atomic<bool>* const c = new std::atomic<bool>[max_threads()]();
+    return c;
+}
+inline std::atomic<std::size_t> slots_in_use{0}; // high-water mark of claimed slots
+
+class thread_slot
+{
+private:
+    std::size_t i = 0;
+
+public:
+    thread_slot() {
+        for (; i < max_threads(); i++) {
+            bool expected = false;
+            if (!claimed()[i].load(std::memory_order_relaxed) &&
+                claimed()[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                std::size_t n = slots_in_use.load(std::memory_order_relaxed);
+                while (n < i + 1 && !slots_in_use.compare_exchange_weak(n, i + 1)) {}
+                return;
+            }
+        }
+        throw std::runtime_error("no free flat combining slot");
+    }
+    ~thread_slot() {
+        claimed()[i].store(false, std::memory_order_release);
+    }
+    thread_slot(thread_slot const&) = delete;
+    thread_slot& operator=(thread_slot const&) = delete;
+
+    std::size_t get() const { return i; }
+};
+
+inline std::size_t this_thread() {
+    thread_local thread_slot slot;
+    return slot.get();
+}
+
+}
+
+template<typename Container>
+class flat_combining
+{
+private:
+    static constexpr std::size_t cache_line = 64;
+    static constexpr int combine_passes = 2;
+    static constexpr int spin_count = 128;
+
+    struct alignas(cache_line) record {
+        std::atomic<bool> pending{false};
+        void (*run)(void*, Container&) = nullptr;
+        void* op = nullptr;
+    };
+
+    template<typename F, typename R>
+    struct operation {
+        F& f;
+        std::optional<R> result{};
+        std::exception_ptr error{};
+
+        static void run(void* self, Container& c) {
+            auto& o = *static_cast<operation*>(self);
+            try {
+                o.result.emplace(o.f(c));
+            }
+            catch (...) {
+                o.error = std::current_exception();
+            }
+        }
+    };
+
+    template<typename F>
+    struct operation<F, void> {
+        F& f;
+        std::exception_ptr error{};
+
+        static void run(void* self, Container& c) {
+            auto& o = *static_cast<operation*>(self);
+            try {
+                o.f(c);
+            }
+            catch (...) {
+                o.error = std::current_exception();
+            }
+        }
+    };
+
+    Container c;
+    alignas(cache_line) std::atomic<bool> locked{false};
+    std::unique_ptr<record[]> const records{new record[flat_combining_detail::max_threads()]};
+
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void combine() {
+        for (int pass = 0; pass < combine_passes; pass++) {
+            std::size_t const n = flat_combining_detail::slots_in_use.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < n; i++) {
+                record& r = records[i];
+                if (r.pending.load(std::memory_order_acquire)) {
+                    r.run(r.op, c);
+                    r.pending.store(false, std::memory_order_release);
+                }
+            }
+        }
+    }
+
+    void execute(void (*run)(void*, Container&), void* op) {
+        record& r = records[flat_combining_detail::this_thread()];
+        r.run = run;
+        r.op = op;
+        r.pending.store(true, std::memory_order_release);
+
+        for (int spins = 0; r.pending.load(std::memory_order_acquire); spins++) {
+            if (try_lock()) {
+                combine(); // includes our own record
+                locked.store(false, std::memory_order_release);
+                return;
+            }
+            if (spins >= spin_count) std::this_thread::yield();
+        }
+    }
+
+public:
+    flat_combining() = default;
+    template<typename... Args>
+    explicit flat_combining(std::in_place_t, Args&&... args) : c(std::forward<Args>(args)...) {}
+    flat_combining(flat_combining const&) = delete;
+    flat_combining& operator=(flat_combining const&) = delete;
+
+    // Runs f(container) with exclusive access to the container, possibly on another thread.
+    template<typename F>
+    std::invoke_result_t<F&, Container&> apply(F&& f) {
+        using R = std::invoke_result_t<F&, Container&>;
+        operation<std::remove_reference_t<F>, R> op{f};
+        execute(&decltype(op)::run, &op);
+        if (op.error) std::rethrow_exception(op.error);
+        if constexpr (!std::is_void_v<R>) return std::move(*op.result);
+    }
+};
+
+template<typename T>
+class fc_stack
+{
+private:
+    flat_combining<std::stack<T>> fc;
+
+public:
+    void push(T value) {
+        fc.apply([&](std::stack<T>& s) { s.push(std::move(value)); });
+    }
+
+    bool try_pop(T& value) {
+        return fc.apply([&](std::stack<T>& s) {
+            if (s.empty()) return false;
+            value = std::move(s.top());
+            s.pop();
+            return true;
+        });
+    }
+
+    std::optional<T> try_pop() {
+        return fc.apply([](std::stack<T>& s) -> std::optional<T> {
+            if (s.empty()) return std::nullopt;
+            std::optional<T> ret{std::move(s.top())};
+            s.pop();
+            return ret;
+        });
+    }
+
+    bool empty() {
+        return fc.apply([](std::stack<T>& s) { return s.empty(); });
+    }
+};
+
+template<typename T>
+class fc_queue
+{
+private:
+    flat_combining<std::queue<T>> fc;
+
+public:
+    void push(T value) {
+        fc.apply([&](std::queue<T>& q) { q.push(std::move(value)); });
+    }
+
+    bool try_pop(T& value) {
+        return fc.apply([&](std::queue<T>& q) {
+            if (q.empty()) return false;
+            value = std::move(q.front());
+            q.pop();
+            return true;
+        });
+    }
+
+    std::optional<T> try_pop() {
+        return fc.apply([](std::queue<T>& q) -> std::optional<T> {
+            if (q.empty()) return std::nullopt;
+            std::optional<T> ret{std::move(q.front())};
+            q.pop();
+            return ret;
+        });
+    }
+
+    bool empty() {
+        return fc.apply([](std::queue<T>& q) { return q.empty(); });
+    }
+};
+
+template<typename Key, typename Value>
+class fc_map
+{
+private:
+    flat_combining<std::map<Key, Value>> fc;
+
+public:
+    void insert_or_assign(Key const& key, Value value) {
+        fc.apply([&](std::map<Key, Value>& m) { m.insert_or_assign(key, std::move(value)); });
+    }
+
+    // a copy of the value, since a reference into the map would outlive the operation
+    std::optional<Value> find(Key const& key) {
+        return fc.apply([&](std::map<Key, Value>& m) -> std::optional<Value> {
+            auto const it = m.find(key);
+            if (it == m.end()) return std::nullopt;
+            return it->second;
+        });
+    }
+
+    bool erase(Key const& key) {
+        return fc.apply([&](std::map<Key, Value>& m) { return m.erase(key) != 0; });
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * Minimal hazard pointer domain (Maged Michael, 2004).
+ *
+ * Every thread owns one record with `slots_per_thread` hazard slots. Before a thread
+ * dereferences a node that other threads may unlink and free, it publishes the node's
+ * address in one of its slots and re-validates that the node is still reachable.
+ * A thread that wants to free an unlinked node first takes a snapshot of all
+ * published hazard pointers and only frees nodes that do not appear in it.
+ *
+ * Records are claimed lazily by the first hazard-pointer operation of a thread and
+ * released when the thread exits. There are max_threads() records, 4 per hardware
+ * thread but at least 128; a thread that finds none free throws std::runtime_error.
+ * Snapshots only scan up to the highest record ever claimed.
+ */
+namespace hazard_pointer {
+
+constexpr std::size_t slots_per_thread = 2;
+
+struct alignas(64) record {
+    std::atomic<bool> active{false};
+    std::atomic<void*> slot[slots_per_thread] = {};
+};
+
+inline std::size_t max_threads() {
+    static std::size_t const n = std::max<std::size_t>(128, 4 * std::size_t(std::thread::hardware_concurrency()));
+    return n;
+}
+
+// never freed, exiting threads may still release their records during static destruction
+inline record* records() {
+    static record* const r = new record[max_threads()];
+    return r;
+}
+
+inline std::atomic<std::size_t> records_in_use{0}; // high-water mark of claimed records
+
+class thread_record
+{
+private:
+    record* r = nullptr;
+
+public:
+    thread_record() {
+        for (std::size_t i = 0; i < max_threads(); i++) {
+            record& rec = records()[i];
+            bool expected = false;
+            if (!rec.active.load(std::memory_order_relaxed) &&
+                rec.active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                // before the thread publishes anything, so snapshots cover the record
+                std::size_t n = records_in_use.load();
+                while (n < i + 1 && !records_in_use.compare_exchange_weak(n, i + 1)) {}
+                r = &rec;
+                return;
+            }
+        }
+        throw std::runtime_error("no free hazard pointer record");
+    }
+    ~thread_record() {
+        for (auto& s : r->slot) s.store(nullptr, std::memory_order_release);
+        r->active.store(false, std::memory_order_release);
+    }
+    thread_record(thread_record const&) = delete;
+    thread_record& operator=(thread_record const&) = delete;
+
+    record& get() { return *r; }
+};
+
+inline record& this_thread() {
+    thread_local thread_record r;
+    return r.get();
+}
+
+// Publishes *src in slot i and returns it once the published value is confirmed to
+// still be the current one, i.e. it was reachable when the hazard became visible.
+template<typename T>
+T* protect(record& rec, std::size_t i, std::atomic<T*> const& src) {
+    T* p = src.load(std::memory_order_relaxed);
+    for (;;) {
+        rec.slot[i].store(p);
+        T* const q = src.load();
+        if (q == p) return p;
+        p = q;
+    }
+}
+
+inline void clear(record& rec) {
+    for (auto& s : rec.slot) s.store(nullptr, std::memory_order_release);
+}
+
+// sorted snapshot of every currently published hazard pointer
+inline void snapshot(std::vector<void*>& out) {
+    out.clear();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::size_t const n = records_in_use.load();
+    for (std::size_t i = 0; i < n; i++) {
+        for (auto& s : records()[i].slot) {
+            if (void* p = s.load()) out.push_back(p);
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hazard_pointer.h"
+
+/**
+ * Unbounded lock-free queue (Michael & Scott, 1996) with hazard-pointer reclamation.
+ *
+ * The queue is a singly linked list with a dummy node at the head. push() links a
+ * new node behind the tail with a CAS on tail->next and then swings tail; try_pop()
+ * swings head to head->next with a CAS and takes the value out of the new dummy.
+ * Both help a lagging tail forward, so no thread ever waits for another one.
+ *
+ * Reclamation: a popped dummy node may still be read by a thread that loaded head
+ * just before the CAS. Every thread therefore publishes the nodes it reads as hazard
+ * pointers (hazard_pointer.h), retired nodes are collected in a thread-local list and
+ * only recycled once a scan finds them unprotected.
+ *
+ * Recycling: nodes never go back to malloc. Reclaimed nodes go to a thread-local
+ * free list; surplus nodes are handed to a shared pool in batches of `batch` nodes,
+ * so a producer thread whose nodes are reclaimed by consumers still gets them back.
+ * The pool mutex is taken once per batch, not once per operation.
+ */
+template<typename T>
+class lock_free_queue
+{
+private:
+    struct node {
+        std::atomic<node*> next{nullptr};
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* value() { return std::launder(reinterpret_cast<T*>(&storage)); }
+    };
+
+    // Per-node-type recycling: one thread_cache per thread holds the thread's free list
+    // and its retired list, the shared pool collects surplus free nodes in batches.
+    class node_pool
+    {
+    private:
+        static constexpr std::size_t batch = 64;
+        static std::size_t retire_threshold() {
+            return 2 * hazard_pointer::max_threads() * hazard_pointer::slots_per_thread;
+        }
+
+        struct free_list {
+            node* head = nullptr;
+            std::size_t count = 0;
+
+            void push(node* n) {
+                n->next.store(head, std::memory_order_relaxed);
+                head = n;
+                ++count;
+            }
+            node* pop() {
+                node* const n = head;
+                head = n->next.load(std::memory_order_relaxed);
+                --count;
+                n->next.store(nullptr, std::memory_order_relaxed);
+                return n;
+            }
+            // splits off everything after the first `keep` nodes
+            free_list split(std::size_t keep) {
+                node* last = head;
+                for (std::size_t i = 1; i < keep; i++) last = last->next.load(std::memory_order_relaxed);
+                free_list rest{last->next.load(std::memory_order_relaxed), count - keep};
+                last->next.store(nullptr, std::memory_order_relaxed);
+                count = keep;
+                return rest;
+            }
+        };
+
+        struct shared_pool {
+            std::mutex m;
+            std::vector<free_list> lists;
+            ~shared_pool() {
+                for (free_list& l : lists) {
+                    while (l.head) delete l.pop();
+                }
+            }
+        };
+
+        struct thread_cache {
+            free_list free;
+            std::vector<node*> retired;
+            std::vector<void*> hazards;
+
+            thread_cache() {
+                retired.reserve(retire_threshold());
+                hazards.reserve(retire_threshold());
+            }
+            ~thread_cache() {
+                // hazards are only held for the duration of one operation, so this terminates quickly
+                while (!retired.empty()) {
+                    scan();
+                    if (!retired.empty()) std::this_thread::yield();
+                }
+                if (free.head) give(free);
+            }
+
+            void scan() {
+                hazard_pointer::snapshot(hazards);
+                auto const reclaim = std::partition(retired.begin(), retired.end(), [this](node* n) {
+                    return std::binary_search(hazards.begin(), hazards.end(), static_cast<void*>(n));
+                });
+                std::for_each(reclaim, retired.end(), [this](node* n) { put(n); });
+                retired.erase(reclaim, retired.end());
+            }
+
+            void put(node* n) {
+                free.push(n);
+                if (free.count >= 2 * batch) give(free.split(batch));
+            }
+        };
+
+        static shared_pool& shared() {
+            static shared_pool pool;
+            return pool;
+        }
+        static thread_cache& cache() {
+            thread_local thread_cache c;
+            return c;
+        }
+        static void give(free_list l) {
+            shared_pool& s = shared();
+            std::lock_guard lock(s.m);
+            s.lists.push_back(l);
+        }
+
+    public:
+        static node* get() {
+            thread_cache& c = cache();
+            if (!c.free.head) {
+                shared_pool& s = shared();
+                std::lock_guard lock(s.m);
+                if (!s.lists.empty()) {
+                    c.free = s.lists.back();
+                    s.lists.pop_back();
+                }
+            }
+            if (!c.free.head) return new node;
+            return c.free.pop();
+        }
+
+        // n is unreachable and nobody can hold a reference to it any more
+        static void put(node* n) {
+            cache().put(n);
+        }
+
+        // n is unlinked but other threads may still read it; recycled once no hazard pointer protects it
+        static void retire(node* n) {
+            thread_cache& c = cache();
+            c.retired.push_back(n);
+            if (c.retired.size() >= retire_threshold()) c.scan();
+        }
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    alignas(cache_line) std::atomic<node*> head;
+    alignas(cache_line) std::atomic<node*> tail;
+
+    template<typename... Args>
+    void enqueue(Args&&... args) {
+        node* const n = node_pool::get();
+        try {
+            new (&n->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            node_pool::put(n);
+            throw;
+        }
+
+        hazard_pointer::record& hp = hazard_pointer::this_thread();
+        for (;;) {
+            node* t = hazard_pointer::protect(hp, 0, tail);
+            node* next = t->next.load();
+            if (next) {
+                // tail is lagging behind, help it forward
+                tail.compare_exchange_weak(t, next);
+                continue;
+            }
+            if (t->next.compare_exchange_weak(next, n)) {
+                tail.compare_exchange_strong(t, n);
+                break;
+            }
+        }
+        hazard_pointer::clear(hp);
+    }
+
+    template<typename Take>
+    bool dequeue(Take take) {
+        hazard_pointer::record& hp = hazard_pointer::this_thread();
+        for (;;) {
+            node* h = hazard_pointer::protect(hp, 0, head);
+            node* const next = h->next.load();
+            hp.slot[1].store(next);
+            if (head.load() != h) continue;
+            if (!next) {
+                hazard_pointer::clear(hp);
+                return false;
+            }
+
+            node* t = tail.load();
+            if (h == t) {
+                tail.compare_exchange_weak(t, next);
+                continue;
+            }
+            if (head.compare_exchange_strong(h, next)) {
+                // next is the new dummy; only the winner of the CAS touches its value
+                T* const p = next->value();
+                take(*p);
+                p->~T();
+                hazard_pointer::clear(hp);
+                node_pool::retire(h);
+                return true;
+            }
+        }
+    }
+
+public:
+    lock_free_queue() {
+        node* const dummy = node_pool::get();
+        head.store(dummy, std::memory_order_relaxed);
+        tail.store(dummy, std::memory_order_relaxed);
+    }
+    lock_free_queue(lock_free_queue const&) = delete;
+    lock_free_queue& operator=(lock_free_queue const&) = delete;
+
+    ~lock_free_queue() {
+        node* const dummy = head.load(std::memory_order_relaxed);
+        node* n = dummy->next.load(std::memory_order_relaxed);
+        node_pool::put(dummy); // the dummy holds no value
+        while (n) {
+            node* const next = n->next.load(std::memory_order_relaxed);
+            n->value()->~T();
+            node_pool::put(n);
+            n = next;
+        }
+    }
+
+    void push(T value) {
+        enqueue(std::move(value));
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        enqueue(std::forward<Args>(args)...);
+    }
+
+    bool try_pop(T& value) {
+        return dequeue([&](T& v) { value = std::move(v); });
+    }
+
+    std::optional<T> try_pop() {
+        std::optional<T> ret;
+        dequeue([&](T& v) { ret.emplace(std::move(v)); });
+        return ret;
+    }
+
+    // only a snapshot when called concurrently with push/pop
+    bool empty() const {
+        hazard_pointer::record& hp = hazard_pointer::this_thread();
+        node* const h = hazard_pointer::protect(hp, 0, head);
+        bool const ret = h->next.load() == nullptr;
+        hazard_pointer::clear(hp);
+        return ret;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Relaxed concurrent priority queue (MultiQueue, Rihani/Sanders/Dementiev).
+ *
+ * The queue consists of k independent binary heaps, each protected by its own mutex.
+ * - push(priority, value) locks one randomly chosen heap (try_lock, another heap is
+ *   picked if it is busy) and inserts there.
+ * - try_pop_min() samples two random heaps, reads their cached minimum without
+ *   locking and pops from the better one. Smaller priority values come out first.
+ *
+ * The result is not the exact global minimum but, with high probability, one of the
+ * O(k) smallest elements. In exchange threads rarely meet on the same lock or the
+ * same cache line, so throughput grows with the number of threads. Use k of about
+ * 2-4 times the number of threads touching the queue.
+ */
+template<typename T, typename Priority = unsigned long>
+class multi_queue
+{
+private:
+    static constexpr std::size_t cache_line = 64;
+    static constexpr Priority empty_top = std::numeric_limits<Priority>::max();
+
+    struct entry {
+        Priority priority;
+        T value;
+    };
+    struct later {
+        bool operator()(entry const& a, entry const& b) const { return a.priority > b.priority; }
+    };
+
+    struct alignas(cache_line) heap {
+        std::mutex m;
+        std::vector<entry> items;                 // min-heap, guarded by m
+        std::atomic<Priority> top{empty_top};     // cached items.front().priority, read without m
+        std::atomic<std::size_t> size{0};
+
+        // m must be held
+        void update() {
+            size.store(items.size(), std::memory_order_relaxed);
+            top.store(items.empty() ? empty_top : items.front().priority, std::memory_order_relaxed);
+        }
+    };
+
+    std::unique_ptr<heap[]> const heaps;
+    std::size_t const k;
+
+    static std::uint64_t next_random() {
+        // xorshift64*, one state per thread
+        thread_local std::uint64_t x = 0x9E3779B97F4A7C15ull ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        return x * 0x2545F4914F6CDD1Dull;
+    }
+
+    std::size_t random_heap() const {
+        return next_random() % k;
+    }
+
+    // heap.m must be held and heap must not be empty, take(entry&) moves the element out
+    template<typename Take>
+    static void pop_top(heap& h, Take& take) {
+        std::pop_heap(h.items.begin(), h.items.end(), later{});
+        take(h.items.back());
+        h.items.pop_back();
+        h.update();
+    }
+
+    // locks every heap in turn; used when the random samples keep finding empty heaps
+    template<typename Take>
+    bool pop_any(Take& take) {
+        std::size_t const start = random_heap();
+        for (std::size_t n = 0; n < k; n++) {
+            heap& h = heaps[(start + n) % k];
+            if (h.size.load(std::memory_order_relaxed) == 0) continue;
+            std::lock_guard lock(h.m);
+            if (!h.items.empty()) {
+                pop_top(h, take);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename Take>
+    bool pop_min(Take take) {
+        for (int attempt = 0; attempt < 8; attempt++) {
+            std::size_t i = random_heap(), j = random_heap();
+            Priority const pi = heaps[i].top.load(std::memory_order_relaxed);
+            Priority const pj = heaps[j].top.load(std::memory_order_relaxed);
+            if (pj < pi) i = j;
+
+            heap& h = heaps[i];
+            if (h.size.load(std::memory_order_relaxed) == 0) continue;
+            std::unique_lock lock(h.m, std::try_to_lock);
+            if (!lock.owns_lock() || h.items.empty()) continue;
+
+            pop_top(h, take);
+            return true;
+        }
+        return pop_any(take);
+    }
+
+public:
+    explicit multi_queue(std::size_t num_heaps = 2 * std::max(1u, std::thread::hardware_concurrency()))
+        : heaps{new heap[std::max<std::size_t>(2, num_heaps)]}, k{std::max<std::size_t>(2, num_heaps)} {}
+    multi_queue(multi_queue const&) = delete;
+    multi_queue& operator=(multi_queue const&) = delete;
+
+    template<typename... Args>
+    void push(Priority priority, Args&&... args) {
+        for (;;) {
+            heap& h = heaps[random_heap()];
+            std::unique_lock lock(h.m, std::try_to_lock);
+            if (!lock.owns_lock()) continue;
+
+            h.items.push_back(entry{priority, T(std::forward<Args>(args)...)});
+            std::push_heap(h.items.begin(), h.items.end(), later{});
+            h.update();
+            return;
+        }
+    }
+
+    bool try_pop_min(Priority& priority, T& value) {
+        return pop_min([&](entry& e) {
+            priority = e.priority;
+            value = std::move(e.value);
+        });
+    }
+
+    bool try_pop_min(T& value) {
+        return pop_min([&](entry& e) { value = std::move(e.value); });
+    }
+
+    std::optional<T> try_pop_min() {
+        std::optional<T> ret;
+        pop_min([&](entry& e) { ret.emplace(std::move(e.value)); });
+        return ret;
+    }
+
+    // only a snapshot when called concurrently with push/pop
+    bool empty() const {
+        for (std::size_t i = 0; i < k; i++) {
+            if (heaps[i].size.load(std::memory_order_relaxed) != 0) return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,242 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * Recycling pool for fixed-size blocks, and a std allocator built on top of it.
+ *
+ * fixed_pool<Size> hands out blocks of one size. Every thread keeps a private free
+ * list, so allocate()/deallocate() normally touch no shared state at all. A thread
+ * that frees more blocks than it allocates (a consumer freeing a producer's nodes)
+ * hands surplus blocks to a global lock-free free list in batches of `batch` blocks,
+ * and a thread whose cache runs dry takes a whole batch from there; only when the
+ * global list is empty is a new slab of `batch` blocks taken from operator new.
+ * The global list is a Treiber stack of batch descriptors whose top carries a 16-bit
+ * tag against ABA, like lock_free_stack. The link between batches lives in the
+ * descriptor, not in a block: a thread that loses the race for a batch may still read
+ * the link, and descriptors, unlike blocks, are never handed to the user. Empty
+ * descriptors go to a second tagged stack and are reused, never freed.
+ *
+ * Blocks are never given back to operator new: the pool keeps the high-water mark of
+ * every block size for the lifetime of the program.
+ *
+ * pool_allocator<T> routes requests of up to max_pooled bytes to the fixed_pool of the
+ * next power-of-two size class, so node-based and chunked containers (std::list,
+ * std::map, the chunks of std::deque behind std::queue and std::stack) recycle their
+ * memory instead of going through malloc on every node. Larger requests and
+ * over-aligned types fall back to operator new.
+ */
+template<std::size_t Size>
+class fixed_pool
+{
+public:
+    static constexpr std::size_t alignment = 16;
+    static constexpr std::size_t block_size = (Size < alignment ? alignment : Size + alignment - 1) / alignment * alignment;
+    static constexpr std::size_t batch = 64;
+
+private:
+    static_assert(sizeof(void*) == 8, "tagged pointers need 64-bit addresses");
+
+    struct block {
+        std::atomic<block*> next; // within a thread cache or a batch
+    };
+    static_assert(sizeof(block) <= block_size);
+
+    struct batch_desc {
+        std::atomic<batch_desc*> next;
+        block* head; // written before the descriptor is pushed, read after it was popped
+    };
+
+    // trivially destructible, so it stays usable while other thread_locals are destroyed
+    struct cache {
+        block* head;
+        std::size_t count;
+        bool registered;
+        bool flushed;
+    };
+
+    // gives the thread's cache back to the global list at thread exit; frees after that
+    // go straight to the global list
+    struct cache_guard {
+        ~cache_guard() {
+            cache& c = local;
+            if (c.head) give(c.head);
+            c.head = nullptr;
+            c.count = 0;
+            c.flushed = true;
+        }
+    };
+
+    static constexpr int tag_shift = 48;
+    static constexpr std::uint64_t ptr_mask = (std::uint64_t{1} << tag_shift) - 1;
+
+    static inline thread_local cache local{};
+    static inline std::atomic<std::uint64_t> global{0}; // full batches
+    static inline std::atomic<std::uint64_t> spare{0};  // empty descriptors
+
+    static batch_desc* ptr(std::uint64_t tagged) {
+        return reinterpret_cast<batch_desc*>(tagged & ptr_mask);
+    }
+    static std::uint64_t make(batch_desc* p, std::uint64_t prev) {
+        return reinterpret_cast<std::uintptr_t>(p) | (((prev >> tag_shift) + 1) << tag_shift);
+    }
+
+    static void push(std::atomic<std::uint64_t>& top, batch_desc* d) {
+        std::uint64_t old = top.load(std::memory_order_relaxed);
+        do {
+            d->next.store(ptr(old), std::memory_order_relaxed);
+        } while (!top.compare_exchange_weak(old, make(d, old), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static batch_desc* pop(std::atomic<std::uint64_t>& top) {
+        std::uint64_t old = top.load(std::memory_order_acquire);
+        for (;;) {
+            batch_desc* const d = ptr(old);
+            if (!d) return nullptr;
+            // d may have been popped and reused meanwhile; the tag makes the CAS fail then
+            batch_desc* const next = d->next.load(std::memory_order_relaxed);
+            if (top.compare_exchange_weak(old, make(next, old), std::memory_order_acquire, std::memory_order_acquire)) {
+                return d;
+            }
+        }
+    }
+
+    static void give(block* first) {
+        batch_desc* d = pop(spare);
+        if (!d) d = new batch_desc{{nullptr}, nullptr}; // never freed, see above
+        d->head = first;
+        push(global, d);
+    }
+
+    static block* take() {
+        batch_desc* const d = pop(global);
+        if (!d) return nullptr;
+        block* const b = d->head;
+        push(spare, d);
+        return b;
+    }
+
+    static block* new_slab() {
+        char* const slab = static_cast<char*>(::operator new(batch * block_size));
+        block* head = nullptr;
+        for (std::size_t i = batch; i-- > 0; ) {
+            block* const b = new (slab + i * block_size) block{{head}};
+            head = b;
+        }
+        return head;
+    }
+
+    static block* take_or_allocate() {
+        block* const b = take();
+        return b ? b : new_slab();
+    }
+
+    static void register_cache(cache& c) {
+        thread_local cache_guard guard;
+        (void)guard;
+        c.registered = true;
+    }
+
+public:
+    static void* allocate() {
+        cache& c = local;
+        if (!c.head) {
+            if (!c.registered) register_cache(c);
+            block* const b = take_or_allocate();
+            if (c.flushed) {
+                // the thread is exiting, keep one block and return the rest of the batch
+                if (block* const rest = b->next.load(std::memory_order_relaxed)) give(rest);
+                return b;
+            }
+            c.head = b;
+            c.count = 0;
+            for (block* p = b; p; p = p->next.load(std::memory_order_relaxed)) ++c.count;
+        }
+        block* const b = c.head;
+        c.head = b->next.load(std::memory_order_relaxed);
+        --c.count;
+        return b;
+    }
+
+    static void deallocate(void* p) noexcept {
+        cache& c = local;
+        block* const b = new (p) block{{nullptr}};
+        if (c.flushed) {
+            give(b);
+            return;
+        }
+        if (!c.registered) register_cache(c);
+
+        b->next.store(c.head, std::memory_order_relaxed);
+        c.head = b;
+        if (++c.count < 2 * batch) return;
+
+        // keep the most recently freed (cache-warm) blocks, give away one batch behind them
+        block* last = c.head;
+        for (std::size_t i = 1; i < batch; i++) last = last->next.load(std::memory_order_relaxed);
+        block* const surplus = last->next.load(std::memory_order_relaxed);
+        last->next.store(nullptr, std::memory_order_relaxed);
+        c.count = batch;
+        give(surplus);
+    }
+};
+
+namespace pool_detail {
+
+constexpr std::size_t max_pooled = 1024;
+
+template<std::size_t Size = 16>
+void* allocate(std::size_t bytes) {
+    if constexpr (Size < max_pooled) {
+        if (bytes > Size) return allocate<Size * 2>(bytes);
+    }
+    return fixed_pool<Size>::allocate();
+}
+
+template<std::size_t Size = 16>
+void deallocate(void* p, std::size_t bytes) noexcept {
+    if constexpr (Size < max_pooled) {
+        if (bytes > Size) return deallocate<Size * 2>(p, bytes);
+    }
+    fixed_pool<Size>::deallocate(p);
+}
+
+}
+
+template<typename T>
+class pool_allocator
+{
+private:
+    static constexpr bool poolable = alignof(T) <= fixed_pool<16>::alignment;
+
+public:
+    using value_type = T;
+
+    pool_allocator() noexcept = default;
+    template<typename U>
+    pool_allocator(pool_allocator<U> const&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        std::size_t const bytes = n * sizeof(T);
+        if (poolable && bytes <= pool_detail::max_pooled) {
+            return static_cast<T*>(pool_detail::allocate(bytes));
+        }
+        return static_cast<T*>(::operator new(bytes, std::align_val_t{alignof(T)}));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        std::size_t const bytes = n * sizeof(T);
+        if (poolable && bytes <= pool_detail::max_pooled) {
+            pool_detail::deallocate(p, bytes);
+            return;
+        }
+        ::operator delete(p, std::align_val_t{alignof(T)});
+    }
+
+    template<typename U>
+    bool operator==(pool_allocator<U> const&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(pool_allocator<U> const&) const noexcept { return false; }
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "threadsafe_queue.h"
+
+/**
+ * Sharded queue: a facade over N independent lanes with the threadsafe_queue interface.
+ *
+ * Every thread is bound to one lane (thread id % N). push() always goes to the
+ * calling thread's lane; a pop tries the own lane first and only steals from the
+ * other lanes, in round-robin order starting after its own, when its lane is empty.
+ * With one lane per worker most operations stay on a lane nobody else touches, so
+ * throughput scales with the number of threads.
+ *
+ * FIFO order only holds per lane: two elements pushed by the same thread come out in
+ * order, elements pushed by different threads may be reordered.
+ *
+ * wait_and_pop polls the lanes for a while and then parks on a condition variable.
+ * Producers only take the park mutex when some consumer is parked (sleepers != 0).
+ */
+template<typename T, typename Lane = threadsafe_queue<T>>
+class sharded_queue
+{
+private:
+    static constexpr std::size_t cache_line = 64;
+    static constexpr int spin_rounds = 64;
+
+    struct alignas(cache_line) padded_lane {
+        Lane q;
+    };
+
+    std::unique_ptr<padded_lane[]> const lanes;
+    std::size_t const n;
+
+    alignas(cache_line) std::atomic<int> sleepers{0};
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+
+    static std::size_t thread_slot() {
+        static std::atomic<std::size_t> next{0};
+        thread_local std::size_t const slot = next.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    std::size_t own_lane() const {
+        return thread_slot() % n;
+    }
+
+    void wake_sleeper() {
+        if (sleepers.load() == 0) return;
+        { std::lock_guard lock(park_mutex); }
+        park_cv.notify_one();
+    }
+
+public:
+    explicit sharded_queue(std::size_t num_lanes = std::max(1u, std::thread::hardware_concurrency()))
+        : lanes{new padded_lane[std::max<std::size_t>(1, num_lanes)]}, n{std::max<std::size_t>(1, num_lanes)} {}
+    sharded_queue(sharded_queue const&) = delete;
+    sharded_queue& operator=(sharded_queue const&) = delete;
+
+    void push(T value) {
+        lanes[own_lane()].q.push(std::move(value));
+        wake_sleeper();
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        lanes[own_lane()].q.emplace(std::forward<Args>(args)...);
+        wake_sleeper();
+    }
+
+    bool try_pop(T& value) {
+        std::size_t const own = own_lane();
+        for (std::size_t i = 0; i < n; i++) {
+            if (lanes[(own + i) % n].q.try_pop(value)) return true;
+        }
+        return false;
+    }
+
+    std::optional<T> try_pop() {
+        std::size_t const own = own_lane();
+        for (std::size_t i = 0; i < n; i++) {
+            if (auto ret = lanes[(own + i) % n].q.try_pop()) return ret;
+        }
+        return std::nullopt;
+    }
+
+    void wait_and_pop(T& value) {
+        for (int i = 0; i < spin_rounds; i++) {
+            if (try_pop(value)) return;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock lock(park_mutex);
+        sleepers.fetch_add(1);
+        while (!try_pop(value)) {
+            park_cv.wait(lock);
+        }
+        sleepers.fetch_sub(1);
+    }
+
+    std::optional<T> wait_and_pop() {
+        std::optional<T> ret;
+        for (int i = 0; i < spin_rounds; i++) {
+            if ((ret = try_pop())) return ret;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock lock(park_mutex);
+        sleepers.fetch_add(1);
+        while (!(ret = try_pop())) {
+            park_cv.wait(lock);
+        }
+        sleepers.fetch_sub(1);
+        return ret;
+    }
+
+    // only a snapshot when called concurrently with push/pop
+    bool empty() const {
+        for (std::size_t i = 0; i < n; i++) {
+            if (!lanes[i].q.empty()) return false;
+        }
+        return true;
+    }
+
+    std::size_t lane_count() const {
+        return n;
+    }
+};
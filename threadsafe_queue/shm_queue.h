@@ -0,0 +1,260 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Inter-process queue in a POSIX shared-memory segment.
+ *
+ * The segment holds a small header followed by a fixed-capacity ring of fixed-size
+ * slots (one T each). Producer and consumer processes map the same segment and copy
+ * elements straight into and out of the ring, so no data passes through the kernel;
+ * system calls only happen when a process has to block.
+ *
+ * Blocking uses a process-shared pthread mutex and two process-shared condition
+ * variables. The mutex is robust: if a process dies while holding it, the next process
+ * to lock it marks it consistent and carries on (the ring indices are only updated
+ * after a slot has been fully written or read, so they are never half-done).
+ * Like threadsafe_queue, a push or pop only signals when the other side is actually
+ * waiting.
+ *
+ * One process calls create(), any number of others open() the segment by name. Since
+ * the slots are copied byte-wise between address spaces, T must be trivially copyable
+ * and must not contain pointers into process memory.
+ */
+template<typename T>
+class shm_queue
+{
+private:
+    static_assert(std::is_trivially_copyable_v<T>, "shm_queue elements are copied between processes");
+
+    static constexpr std::size_t cache_line = 64;
+    static constexpr std::uint32_t ready_magic = 0x5348'4d51; // "SHMQ"
+
+    struct header {
+        std::atomic<std::uint32_t> ready;
+        std::uint32_t slot_size;
+        std::uint64_t capacity;
+        pthread_mutex_t mutex;
+        pthread_cond_t not_empty;
+        pthread_cond_t not_full;
+        // guarded by mutex
+        std::uint64_t head;
+        std::uint64_t tail;
+        std::uint32_t waiting_consumers;
+        std::uint32_t waiting_producers;
+    };
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the ready flag must be address-free");
+
+    static constexpr std::size_t slots_offset =
+        (sizeof(header) + alignof(T) + cache_line - 1) / cache_line * cache_line;
+
+    header* h = nullptr;
+    T* slots = nullptr;
+    std::size_t bytes = 0;
+
+    class lock
+    {
+    private:
+        pthread_mutex_t& m;
+
+    public:
+        explicit lock(pthread_mutex_t& m) : m{m} {
+            check_robust(pthread_mutex_lock(&m), m);
+        }
+        ~lock() { pthread_mutex_unlock(&m); }
+        lock(lock const&) = delete;
+        lock& operator=(lock const&) = delete;
+    };
+
+    // the previous owner died holding the mutex; the queue state is consistent, take it over
+    static void check_robust(int r, pthread_mutex_t& m) {
+        if (r == EOWNERDEAD) r = pthread_mutex_consistent(&m);
+        if (r != 0) throw std::system_error(r, std::generic_category(), "shm_queue mutex");
+    }
+
+    static void check(int r, char const* what) {
+        if (r != 0) throw std::system_error(r, std::generic_category(), what);
+    }
+
+    static std::size_t segment_size(std::size_t capacity) {
+        return slots_offset + capacity * sizeof(T);
+    }
+
+    static void* map(int fd, std::size_t size) {
+        void* const p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int const err = errno;
+        close(fd);
+        if (p == MAP_FAILED) throw std::system_error(err, std::generic_category(), "mmap");
+        return p;
+    }
+
+    shm_queue(void* base, std::size_t size)
+        : h{static_cast<header*>(base)}, slots{reinterpret_cast<T*>(static_cast<char*>(base) + slots_offset)}, bytes{size} {}
+
+    void init(std::size_t capacity) {
+        new (h) header{};
+        h->slot_size = sizeof(T);
+        h->capacity = capacity;
+
+        pthread_mutexattr_t ma;
+        check(pthread_mutexattr_init(&ma), "pthread_mutexattr_init");
+        check(pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED), "pthread_mutexattr_setpshared");
+        check(pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST), "pthread_mutexattr_setrobust");
+        check(pthread_mutex_init(&h->mutex, &ma), "pthread_mutex_init");
+        pthread_mutexattr_destroy(&ma);
+
+        pthread_condattr_t ca;
+        check(pthread_condattr_init(&ca), "pthread_condattr_init");
+        check(pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED), "pthread_condattr_setpshared");
+        check(pthread_cond_init(&h->not_empty, &ca), "pthread_cond_init");
+        check(pthread_cond_init(&h->not_full, &ca), "pthread_cond_init");
+        pthread_condattr_destroy(&ca);
+
+        h->ready.store(ready_magic, std::memory_order_release);
+    }
+
+    void wait(pthread_cond_t& cv) {
+        check_robust(pthread_cond_wait(&cv, &h->mutex), h->mutex);
+    }
+
+    // mutex must be held
+    bool full() const { return h->tail - h->head == h->capacity; }
+    bool is_empty() const { return h->tail == h->head; }
+
+    void put(T const& value) {
+        std::memcpy(static_cast<void*>(&slots[h->tail % h->capacity]), &value, sizeof(T));
+        ++h->tail;
+        if (h->waiting_consumers) pthread_cond_signal(&h->not_empty);
+    }
+
+    void get(T& value) {
+        std::memcpy(static_cast<void*>(&value), &slots[h->head % h->capacity], sizeof(T));
+        ++h->head;
+        if (h->waiting_producers) pthread_cond_signal(&h->not_full);
+    }
+
+public:
+    // Creates the segment `name` (e.g. "/my_queue"); fails if it already exists.
+    static shm_queue create(std::string const& name, std::size_t capacity) {
+        if (capacity == 0) throw std::invalid_argument("shm_queue capacity must not be zero");
+        int const fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        std::size_t const size = segment_size(capacity);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            int const err = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+        }
+        shm_queue q{map(fd, size), size};
+        q.init(capacity);
+        return q;
+    }
+
+    // Maps the segment `name` created by another process; waits until its creator has
+    // finished initializing it.
+    static shm_queue open(std::string const& name) {
+        int const fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+        struct stat st;
+        for (;;) {
+            if (fstat(fd, &st) != 0) {
+                int const err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "fstat " + name);
+            }
+            if (static_cast<std::size_t>(st.st_size) >= slots_offset) break;
+            std::this_thread::yield(); // the creator has not sized the segment yet
+        }
+        std::size_t const size = static_cast<std::size_t>(st.st_size);
+        shm_queue q{map(fd, size), size};
+        while (q.h->ready.load(std::memory_order_acquire) != ready_magic) {
+            std::this_thread::yield();
+        }
+        if (q.h->slot_size != sizeof(T) || segment_size(q.h->capacity) > size) {
+            throw std::runtime_error("shm_queue " + name + " holds a different element type");
+        }
+        return q;
+    }
+
+    // Removes the name; processes that still map the segment keep using it.
+    static void unlink(std::string const& name) {
+        shm_unlink(name.c_str());
+    }
+
+    shm_queue(shm_queue&& other) noexcept
+        : h{std::exchange(other.h, nullptr)}, slots{std::exchange(other.slots, nullptr)}, bytes{std::exchange(other.bytes, 0)} {}
+    shm_queue& operator=(shm_queue&& other) noexcept {
+        std::swap(h, other.h);
+        std::swap(slots, other.slots);
+        std::swap(bytes, other.bytes);
+        return *this;
+    }
+    shm_queue(shm_queue const&) = delete;
+    shm_queue& operator=(shm_queue const&) = delete;
+
+    ~shm_queue() {
+        if (h) munmap(h, bytes);
+    }
+
+    // blocks while the ring is full
+    void push(T const& value) {
+        lock l(h->mutex);
+        while (full()) {
+            ++h->waiting_producers;
+            wait(h->not_full);
+            --h->waiting_producers;
+        }
+        put(value);
+    }
+
+    bool try_push(T const& value) {
+        lock l(h->mutex);
+        if (full()) return false;
+        put(value);
+        return true;
+    }
+
+    void wait_and_pop(T& value) {
+        lock l(h->mutex);
+        while (is_empty()) {
+            ++h->waiting_consumers;
+            wait(h->not_empty);
+            --h->waiting_consumers;
+        }
+        get(value);
+    }
+
+    bool try_pop(T& value) {
+        lock l(h->mutex);
+        if (is_empty()) return false;
+        get(value);
+        return true;
+    }
+
+    bool empty() const {
+        lock l(h->mutex);
+        return is_empty();
+    }
+
+    std::size_t capacity() const {
+        return h->capacity;
+    }
+};
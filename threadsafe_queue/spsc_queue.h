@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Bounded wait-free single-producer/single-consumer queue.
+ *
+ * Exactly one thread may push and exactly one (other) thread may pop. The ring
+ * indices only ever grow, the slot is index & mask:
+ * - tail is written only by the producer, head only by the consumer, and each
+ *   lives on its own cache line.
+ * - each side keeps a private copy of the other side's index (cached_head for the
+ *   producer, cached_tail for the consumer) and only reloads the shared one when
+ *   the cached value says the ring is full/empty. In the steady state a handoff
+ *   touches the other side's cache line once per lap instead of once per element.
+ *
+ * try_push/try_pop never block. push/wait_and_pop spin and then yield.
+ */
+template<typename T>
+class spsc_queue
+{
+private:
+    static constexpr std::size_t cache_line = 64;
+    using storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    std::unique_ptr<storage[]> const buffer;
+    std::size_t const mask;
+
+    // consumer side
+    alignas(cache_line) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail{0};
+
+    // producer side
+    alignas(cache_line) std::atomic<std::size_t> tail{0};
+    std::size_t cached_head{0};
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t cap = 2;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    static void wait(int& spins) {
+        if (++spins < 64) return;
+        spins = 0;
+        std::this_thread::yield();
+    }
+
+    T* slot(std::size_t i) {
+        return std::launder(reinterpret_cast<T*>(&buffer[i & mask]));
+    }
+
+public:
+    // capacity is rounded up to the next power of two
+    explicit spsc_queue(std::size_t capacity = 1024)
+        : buffer{new storage[round_up_pow2(capacity)]}, mask{round_up_pow2(capacity) - 1} {}
+    spsc_queue(spsc_queue const&) = delete;
+    spsc_queue& operator=(spsc_queue const&) = delete;
+
+    ~spsc_queue() {
+        std::size_t const end = tail.load(std::memory_order_relaxed);
+        for (std::size_t i = head.load(std::memory_order_relaxed); i != end; i++) {
+            slot(i)->~T();
+        }
+    }
+
+    // producer only
+    template<typename U>
+    bool try_push(U&& value) {
+        std::size_t const t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask) return false;
+        }
+        new (&buffer[t & mask]) T(std::forward<U>(value));
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer only
+    template<typename U>
+    void push(U&& value) {
+        for (int spins = 0; !try_push(std::forward<U>(value)); wait(spins)) {}
+    }
+
+    // consumer only
+    bool try_pop(T& value) {
+        std::size_t const h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) return false;
+        }
+        T* p = slot(h);
+        value = std::move(*p);
+        p->~T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    void wait_and_pop(T& value) {
+        for (int spins = 0; !try_pop(value); wait(spins)) {}
+    }
+
+    // only a snapshot when called concurrently with push/pop
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {
+        return mask + 1;
+    }
+};
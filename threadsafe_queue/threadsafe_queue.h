@@ -0,0 +1,264 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Blocking pops are waiter-aware: a consumer first spins for a short, bounded time
+ * (watching size_hint, so spinning does not take the lock), and only then parks.
+ * Producers signal only when some consumer is actually parked, so under steady load
+ * push() never enters the wakeup path at all.
+ *
+ * With C++20 atomic wait/notify the consumers park on `epoch`: a consumer registers
+ * itself in `sleepers`, rechecks the queue under the lock and waits for the epoch to
+ * change. A producer that sees sleepers != 0 after its push bumps the epoch and
+ * notifies. Either the consumer's recheck sees the new element, or the producer sees
+ * the registered sleeper, so no wakeup can be lost. Without atomic wait the same
+ * scheme runs on a condition variable with the sleeper count guarded by the mutex.
+ *
+ * The Allocator is used for the std::deque under the queue, e.g. pool_allocator<T>
+ * (node_pool.h) recycles the deque's chunks instead of returning them to malloc.
+ *
+ * The value-returning pops return std::optional<T> instead of std::shared_ptr<T>, so a
+ * pop does not allocate and move-only T works; threadsafe_stack and two_lock_queue do
+ * the same. Callers of the old pops that only test and dereference the result keep
+ * working unchanged, others fail to compile.
+ */
+template<typename T, typename Allocator = std::allocator<T>>
+class threadsafe_queue
+{
+private:
+    static constexpr int spin_count = 128;
+
+    mutable std::mutex mutex;
+    std::queue<T, std::deque<T, Allocator>> queue;
+    std::atomic<std::size_t> size_hint{0};
+    std::atomic<std::size_t> notify_count{0};
+#if defined(__cpp_lib_atomic_wait)
+    std::atomic<unsigned> epoch{0};
+    std::atomic<int> sleepers{0};
+#else
+    std::condition_variable cond_var;
+    int sleepers{0}; // guarded by mutex
+#endif
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // mutex must be held
+    void update_size() {
+        size_hint.store(queue.size(), std::memory_order_relaxed);
+    }
+
+    // called after the lock is released, n is the number of pushed elements
+    void notify(std::size_t n, [[maybe_unused]] bool wake) {
+        if (n == 0) return;
+#if defined(__cpp_lib_atomic_wait)
+        if (sleepers.load() == 0) return;
+        notify_count.fetch_add(1, std::memory_order_relaxed);
+        epoch.fetch_add(1, std::memory_order_release);
+        if (n == 1) epoch.notify_one();
+        else epoch.notify_all();
+#else
+        if (!wake) return;
+        notify_count.fetch_add(1, std::memory_order_relaxed);
+        if (n == 1) cond_var.notify_one();
+        else cond_var.notify_all();
+#endif
+    }
+
+    // mutex must be held
+    bool has_sleepers() const {
+#if defined(__cpp_lib_atomic_wait)
+        return false; // checked after unlocking, see notify()
+#else
+        return sleepers != 0;
+#endif
+    }
+
+    // Waits until the queue is not empty and calls pop() with the lock held.
+    template<typename Pop>
+    decltype(auto) wait_for_data(Pop pop) {
+        for (int i = 0; i < spin_count; i++) {
+            if (size_hint.load(std::memory_order_relaxed) != 0) {
+                std::unique_lock lock(mutex);
+                if (!queue.empty()) return pop();
+            }
+            cpu_relax();
+        }
+#if defined(__cpp_lib_atomic_wait)
+        for (;;) {
+            unsigned const e = epoch.load(std::memory_order_acquire);
+            sleepers.fetch_add(1);
+            {
+                std::unique_lock lock(mutex);
+                if (!queue.empty()) {
+                    sleepers.fetch_sub(1);
+                    return pop();
+                }
+            }
+            epoch.wait(e, std::memory_order_acquire);
+            sleepers.fetch_sub(1);
+        }
+#else
+        std::unique_lock lock(mutex);
+        ++sleepers;
+        cond_var.wait(lock, [this]() { return !queue.empty(); });
+        --sleepers;
+        return pop();
+#endif
+    }
+
+    template<typename OutputIt>
+    std::size_t drain(OutputIt& out, std::size_t max_n) {
+        std::size_t n = 0;
+        for (; n < max_n && !queue.empty(); ++n) {
+            *out = std::move(queue.front());
+            ++out;
+            queue.pop();
+        }
+        update_size();
+        return n;
+    }
+
+public: 
+    threadsafe_queue() {}
+    threadsafe_queue(threadsafe_queue const& other) {
+        std::lock_guard lock(other.mutex);
+        queue = other.queue;
+        update_size();
+    }
+
+    void push(T value) {
+        bool wake;
+        {
+            std::lock_guard lock(mutex);
+            queue.push(std::move(value));
+            update_size();
+            wake = has_sleepers();
+        }
+        notify(1, wake);
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        bool wake;
+        {
+            std::lock_guard lock(mutex);
+            queue.emplace(std::forward<Args>(args)...);
+            update_size();
+            wake = has_sleepers();
+        }
+        notify(1, wake);
+    }
+
+    // pushes [first, last) under one lock and wakes the consumers once for the whole batch
+    template<typename InputIt>
+    void push_range(InputIt first, InputIt last) {
+        std::size_t n = 0;
+        bool wake;
+        {
+            std::lock_guard lock(mutex);
+            for (; first != last; ++first, ++n) {
+                queue.push(*first);
+            }
+            update_size();
+            wake = has_sleepers();
+        }
+        notify(n, wake);
+    }
+
+    void push_bulk(std::vector<T>&& values) {
+        push_range(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+        values.clear();
+    }
+
+    void wait_and_pop(T& value) {
+        wait_for_data([&]() {
+            value = std::move(queue.front());
+            queue.pop();
+            update_size();
+        });
+    }
+
+    // always engaged; std::optional keeps the signature in line with try_pop()
+    std::optional<T> wait_and_pop() {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "use wait_and_pop(T&) for T whose move may throw");
+        return wait_for_data([&]() {
+            std::optional<T> ret{std::move(queue.front())};
+            queue.pop();
+            update_size();
+
+            return ret;
+        });
+    }
+
+    bool try_pop(T& value) {
+        std::lock_guard lock(mutex);
+        if (queue.empty()) {
+            return false;
+        }
+
+        value = std::move(queue.front());
+        queue.pop();
+        update_size();
+
+        return true;
+    }
+
+    // returning by value is only safe if moving T out cannot throw after the pop
+    std::optional<T> try_pop() {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "use try_pop(T&) for T whose move may throw");
+        std::lock_guard lock(mutex);
+        if (queue.empty()) {
+            return std::nullopt;
+        }
+
+        std::optional<T> ret{std::move(queue.front())};
+        queue.pop();
+        update_size();
+
+        return ret;
+    }
+
+    // pops up to max_n elements into out under one lock, returns the number of popped elements
+    template<typename OutputIt>
+    std::size_t pop_bulk(OutputIt out, std::size_t max_n) {
+        std::lock_guard lock(mutex);
+        return drain(out, max_n);
+    }
+
+    // waits until at least one element is available, then behaves like pop_bulk
+    template<typename OutputIt>
+    std::size_t wait_and_pop_bulk(OutputIt out, std::size_t max_n) {
+        return wait_for_data([&]() { return drain(out, max_n); });
+    }
+
+    bool empty() const {
+        std::lock_guard lock(mutex);
+        return queue.empty();
+    }
+
+    // number of times a producer had to wake a parked consumer
+    std::size_t notifications() const {
+        return notify_count.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Fine-grained queue built on a singly linked list with a dummy node.
+ *
+ * The list always starts with a dummy node. The node after the dummy holds the front
+ * element; a pop moves the element out and that node becomes the new dummy. push()
+ * only touches tail->next (under tail_mutex) and the pops only touch head and the
+ * element after it (under head_mutex), so when the front node is also the tail node
+ * the two sides still work on different members. The only point where a consumer
+ * looks at the other end is the emptiness check (head == tail), which takes
+ * tail_mutex just long enough to read the tail pointer.
+ *
+ * A pushed element is moved into its node before the tail lock is taken, so push()
+ * makes one allocation and none happens inside either critical section. The pops
+ * hand the element out by value.
+ *
+ * Blocking: wait_and_pop sleeps on cond_var with head_mutex. To avoid a lost wakeup
+ * the producer has to synchronize with head_mutex before notifying, but only when a
+ * consumer is actually sleeping (waiters > 0). With no sleepers push() never touches
+ * the head side at all.
+ */
+template<typename T>
+class two_lock_queue
+{
+private:
+    struct node {
+        std::optional<T> data; // empty in the dummy
+        std::unique_ptr<node> next;
+    };
+
+    mutable std::mutex head_mutex;
+    std::unique_ptr<node> head;
+    std::condition_variable cond_var;
+    std::atomic<int> waiters{0};
+
+    mutable std::mutex tail_mutex;
+    node* tail;
+
+    node* get_tail() const {
+        std::lock_guard lock(tail_mutex);
+        return tail;
+    }
+
+    // head_mutex must be held and the queue must not be empty
+    T& front() {
+        return *head->next->data;
+    }
+
+    // head_mutex must be held and the front element must have been moved out
+    void pop_head() {
+        std::unique_ptr<node> old_head = std::move(head);
+        head = std::move(old_head->next);
+        head->data.reset();
+    }
+
+    std::unique_lock<std::mutex> wait_for_data() {
+        std::unique_lock head_lock(head_mutex);
+        if (head.get() == get_tail()) {
+            waiters.fetch_add(1);
+            cond_var.wait(head_lock, [this]() { return head.get() != get_tail(); });
+            waiters.fetch_sub(1);
+        }
+        return head_lock;
+    }
+
+public:
+    two_lock_queue() : head{new node}, tail{head.get()} {}
+    two_lock_queue(two_lock_queue const&) = delete;
+    two_lock_queue& operator=(two_lock_queue const&) = delete;
+    ~two_lock_queue() {
+        // unlink iteratively, the recursive unique_ptr destruction would overflow the stack on long queues
+        while (head) head = std::move(head->next);
+    }
+
+    void push(T value) {
+        std::unique_ptr<node> p{new node{std::optional<T>{std::move(value)}, nullptr}};
+        {
+            std::lock_guard tail_lock(tail_mutex);
+            node* const new_tail = p.get();
+            tail->next = std::move(p);
+            tail = new_tail;
+        }
+        if (waiters.load() > 0) {
+            { std::lock_guard head_lock(head_mutex); }
+            cond_var.notify_one();
+        }
+    }
+
+    // always engaged; std::optional keeps the signature in line with try_pop()
+    std::optional<T> wait_and_pop() {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "use wait_and_pop(T&) for T whose move may throw");
+        std::unique_lock head_lock(wait_for_data());
+        std::optional<T> ret{std::move(front())};
+        pop_head();
+        return ret;
+    }
+
+    // if the assignment throws, the element stays in the queue
+    void wait_and_pop(T& value) {
+        std::unique_lock head_lock(wait_for_data());
+        value = std::move(front());
+        pop_head();
+    }
+
+    // returning by value is only safe if moving T out cannot throw after the pop
+    std::optional<T> try_pop() {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "use try_pop(T&) for T whose move may throw");
+        std::lock_guard head_lock(head_mutex);
+        if (head.get() == get_tail()) {
+            return std::nullopt;
+        }
+        std::optional<T> ret{std::move(front())};
+        pop_head();
+        return ret;
+    }
+
+    bool try_pop(T& value) {
+        std::lock_guard head_lock(head_mutex);
+        if (head.get() == get_tail()) {
+            return false;
+        }
+        value = std::move(front());
+        pop_head();
+        return true;
+    }
+
+    bool empty() const {
+        std::lock_guard head_lock(head_mutex);
+        return head.get() == get_tail();
+    }
+};
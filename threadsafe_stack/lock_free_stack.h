@@ -0,0 +1,307 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Lock-free stack (Treiber, 1986) with tagged pointers against ABA.
+ *
+ * The top of the stack is a single 64-bit word holding the node address in the low
+ * 48 bits and a 16-bit modification tag in the high bits. Every successful CAS on
+ * top bumps the tag, so a thread that read top, got preempted, and meanwhile saw the
+ * same node popped and pushed again fails its CAS instead of corrupting the list.
+ *
+ * Nodes are never returned to malloc while the stack is alive: a popped node goes to
+ * an internal free list (another tagged Treiber stack) and is reused by the next push.
+ * That keeps the speculative read of top->next in pop() safe, since the node it reads
+ * is always valid memory even if it was popped in the meantime, and it makes push and
+ * pop allocation-free once the stack reached its high-water mark.
+ *
+ * push_list() links a whole range and pop_all() detaches the whole stack with a single
+ * successful CAS on top, so batch transfers cost one contended operation. pop_all() uses
+ * a CAS rather than an exchange because the new, empty top still needs a fresh tag.
+ *
+ * What a push or pop does when its CAS on top fails is selected by the ContentionPolicy:
+ * - contention_policy::none        : retry on top right away.
+ * - contention_policy::elimination : back off into an elimination array (Hendler, Shavit
+ *   and Yerushalmi, 2004). A push offers its node in a random slot and waits there for a
+ *   moment; a pop that failed on top looks into a random slot and takes an offered node.
+ *   A colliding push/pop pair cancels out without touching top, so under symmetric load
+ *   most operations complete in the side array and throughput grows with the thread count.
+ */
+enum class contention_policy { none, elimination };
+
+template<typename T, contention_policy ContentionPolicy = contention_policy::none>
+class lock_free_stack
+{
+private:
+    static_assert(sizeof(void*) == 8, "tagged pointers need 64-bit addresses");
+
+    struct node {
+        std::atomic<node*> next{nullptr};
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* value() { return std::launder(reinterpret_cast<T*>(&storage)); }
+    };
+
+    static constexpr std::size_t cache_line = 64;
+    static constexpr int tag_shift = 48;
+    static constexpr std::uint64_t ptr_mask = (std::uint64_t{1} << tag_shift) - 1;
+
+    static node* ptr(std::uint64_t tagged) {
+        return reinterpret_cast<node*>(tagged & ptr_mask);
+    }
+    static std::uint64_t make(node* p, std::uint64_t prev) {
+        return reinterpret_cast<std::uintptr_t>(p) | (((prev >> tag_shift) + 1) << tag_shift);
+    }
+
+    // pushes the chain first..last onto list with one CAS
+    static void link(std::atomic<std::uint64_t>& list, node* first, node* last) {
+        std::uint64_t old = list.load(std::memory_order_relaxed);
+        do {
+            last->next.store(ptr(old), std::memory_order_relaxed);
+        } while (!list.compare_exchange_weak(old, make(first, old),
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static node* unlink(std::atomic<std::uint64_t>& list) {
+        std::uint64_t old = list.load(std::memory_order_acquire);
+        for (;;) {
+            node* const n = ptr(old);
+            if (!n) return nullptr;
+            // n may already be popped and reused by another thread; the value read here is
+            // then stale, but the tag has changed and the CAS fails
+            node* const next = n->next.load(std::memory_order_relaxed);
+            if (list.compare_exchange_weak(old, make(next, old),
+                                           std::memory_order_acquire, std::memory_order_acquire)) {
+                return n;
+            }
+        }
+    }
+
+    static constexpr bool eliminate = ContentionPolicy == contention_policy::elimination;
+    static constexpr std::size_t elimination_slots = 8;
+    static constexpr int elimination_spins = 128;
+
+    // a slot is empty, holds the node a push offers, or is marked taken by a pop until
+    // the offering push notices and empties it again
+    static constexpr std::uintptr_t slot_empty = 0;
+    static constexpr std::uintptr_t slot_taken = 1;
+
+    struct alignas(cache_line) slot {
+        std::atomic<std::uintptr_t> offer{slot_empty};
+    };
+
+    static std::size_t random_slot() {
+        thread_local std::uint32_t state = static_cast<std::uint32_t>(
+            std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % elimination_slots;
+    }
+
+    // true when a pop took n
+    bool offer(node* n) {
+        slot& s = slots[random_slot()];
+        std::uintptr_t expected = slot_empty;
+        auto const mine = reinterpret_cast<std::uintptr_t>(n);
+        if (!s.offer.compare_exchange_strong(expected, mine, std::memory_order_release, std::memory_order_relaxed)) {
+            return false;
+        }
+        for (int i = 0; i < elimination_spins; i++) {
+            if (s.offer.load(std::memory_order_acquire) == slot_taken) break;
+        }
+        // withdraw the offer; failing means a pop took n in the meantime
+        expected = mine;
+        if (s.offer.compare_exchange_strong(expected, slot_empty, std::memory_order_relaxed)) {
+            return false;
+        }
+        s.offer.store(slot_empty, std::memory_order_release);
+        return true;
+    }
+
+    node* take() {
+        slot& s = slots[random_slot()];
+        std::uintptr_t offered = s.offer.load(std::memory_order_acquire);
+        if (offered == slot_empty || offered == slot_taken) return nullptr;
+        if (!s.offer.compare_exchange_strong(offered, slot_taken, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return reinterpret_cast<node*>(offered);
+    }
+
+    void push_node(node* n) {
+        if constexpr (!eliminate) {
+            link(top, n, n);
+        }
+        else {
+            std::uint64_t old = top.load(std::memory_order_relaxed);
+            for (;;) {
+                n->next.store(ptr(old), std::memory_order_relaxed);
+                if (top.compare_exchange_strong(old, make(n, old), std::memory_order_release, std::memory_order_relaxed)) return;
+                if (offer(n)) return;
+                old = top.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    node* pop_node() {
+        if constexpr (!eliminate) {
+            return unlink(top);
+        }
+        else {
+            std::uint64_t old = top.load(std::memory_order_acquire);
+            for (;;) {
+                node* const n = ptr(old);
+                if (!n) return nullptr;
+                node* const next = n->next.load(std::memory_order_relaxed);
+                if (top.compare_exchange_strong(old, make(next, old), std::memory_order_acquire, std::memory_order_acquire)) return n;
+                if (node* const e = take()) return e;
+                old = top.load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    alignas(cache_line) std::atomic<std::uint64_t> top{0};
+    alignas(cache_line) std::atomic<std::uint64_t> free_nodes{0};
+    slot slots[eliminate ? elimination_slots : 1];
+
+    node* get_node() {
+        if (node* n = unlink(free_nodes)) return n;
+        return new node;
+    }
+
+    void put_node(node* n) {
+        link(free_nodes, n, n);
+    }
+
+    static void delete_list(node* n) {
+        while (n) {
+            node* const next = n->next.load(std::memory_order_relaxed);
+            delete n;
+            n = next;
+        }
+    }
+
+public:
+    lock_free_stack() = default;
+    lock_free_stack(lock_free_stack const&) = delete;
+    lock_free_stack& operator=(lock_free_stack const&) = delete;
+
+    ~lock_free_stack() {
+        for (node* n = ptr(top.load(std::memory_order_relaxed)); n; n = n->next.load(std::memory_order_relaxed)) {
+            n->value()->~T();
+        }
+        delete_list(ptr(top.load(std::memory_order_relaxed)));
+        delete_list(ptr(free_nodes.load(std::memory_order_relaxed)));
+    }
+
+    void push(T value) {
+        emplace(std::move(value));
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        node* const n = get_node();
+        try {
+            new (&n->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            put_node(n);
+            throw;
+        }
+        push_node(n);
+    }
+
+    // Pushes [first, last) as if pushed one by one (the last element ends up on top),
+    // but publishes all of them with one CAS.
+    template<typename InputIt>
+    void push_list(InputIt first, InputIt last) {
+        node* head = nullptr;
+        node* tail = nullptr;
+        try {
+            for (; first != last; ++first) {
+                node* const n = get_node();
+                try {
+                    new (&n->storage) T(*first);
+                }
+                catch (...) {
+                    put_node(n);
+                    throw;
+                }
+                n->next.store(head, std::memory_order_relaxed);
+                head = n;
+                if (!tail) tail = n;
+            }
+        }
+        catch (...) {
+            while (head) {
+                node* const next = head->next.load(std::memory_order_relaxed);
+                head->value()->~T();
+                put_node(head);
+                head = next;
+            }
+            throw;
+        }
+        if (head) link(top, head, tail);
+    }
+
+    bool try_pop(T& value) {
+        node* const n = pop_node();
+        if (!n) return false;
+
+        T* const p = n->value();
+        value = std::move(*p);
+        p->~T();
+        put_node(n);
+        return true;
+    }
+
+    std::optional<T> try_pop() {
+        node* const n = pop_node();
+        if (!n) return std::nullopt;
+
+        T* const p = n->value();
+        std::optional<T> ret{std::move(*p)};
+        p->~T();
+        put_node(n);
+        return ret;
+    }
+
+    // Detaches the whole stack by swinging top to an empty, re-tagged value in a CAS
+    // loop and writes its elements to out in pop order (top first). Returns the number
+    // of elements written.
+    template<typename OutputIt>
+    std::size_t pop_all(OutputIt out) {
+        std::uint64_t old = top.load(std::memory_order_relaxed);
+        while (ptr(old) && !top.compare_exchange_weak(old, make(nullptr, old),
+                                                      std::memory_order_acquire, std::memory_order_relaxed)) {}
+        node* n = ptr(old);
+        if (!n) return 0;
+
+        std::size_t count = 0;
+        node* const head = n;
+        node* tail = n;
+        for (; n; n = n->next.load(std::memory_order_relaxed)) {
+            T* const p = n->value();
+            *out++ = std::move(*p);
+            p->~T();
+            tail = n;
+            ++count;
+        }
+        link(free_nodes, head, tail);
+        return count;
+    }
+
+    // only a snapshot when called concurrently with push/pop
+    bool empty() const {
+        return ptr(top.load(std::memory_order_acquire)) == nullptr;
+    }
+};
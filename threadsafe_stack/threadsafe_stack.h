@@ -0,0 +1,90 @@
+#pragma once
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stack>
+#include <type_traits>
+#include <utility>
+
+struct empty_stack : std::exception
+{
+    const char* what() const throw() {
+        return "empty stack";
+    };
+};
+
+// The Allocator is used for the std::deque under the stack, e.g. pool_allocator<T>
+// (threadsafe_queue/node_pool.h) recycles the deque's chunks.
+//
+// Like threadsafe_queue, the stack has no shared_ptr<T> pops any more: they allocated
+// once per element and did not work for move-only T. The pops return std::optional<T>
+// or move into a T&. Code written against pop() returning shared_ptr<T> does not
+// compile any more instead of silently changing meaning.
+template<typename T, typename Allocator = std::allocator<T>>
+class threadsafe_stack
+{
+private:
+    std::stack<T, std::deque<T, Allocator>> st;
+    mutable std::mutex m;
+
+public:
+    threadsafe_stack() {}
+    threadsafe_stack(threadsafe_stack const& other) {
+        std::lock_guard lock(other.m);
+        st = other.st;
+    }
+    threadsafe_stack& operator=(threadsafe_stack const&) = delete;
+
+    void push(T value) {
+        std::lock_guard lock(m);
+        st.push(std::move(value));
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        std::lock_guard lock(m);
+        st.emplace(std::forward<Args>(args)...);
+    }
+
+    void pop(T& value) {
+        std::lock_guard lock(m);
+        if (st.empty()) throw empty_stack();
+        
+        value = std::move(st.top());
+        st.pop();
+    }
+
+    // Non-throwing pops. The element is moved out of the stack instead of being copied
+    // into a shared_ptr, so popping does not allocate and works for move-only T. Returning
+    // by value is only safe if that move cannot throw after the element left the stack.
+    std::optional<T> try_pop() {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "use try_pop(T&) for T whose move may throw");
+        std::lock_guard lock(m);
+        if (st.empty()) return std::nullopt;
+
+        std::optional<T> ret{std::move(st.top())};
+        st.pop();
+        return ret;
+    }
+
+    bool try_pop(T& value) {
+        std::lock_guard lock(m);
+        if (st.empty()) return false;
+
+        value = std::move(st.top());
+        st.pop();
+        return true;
+    }
+
+    T top() const {
+        std::lock_guard lock(m);
+        return st.top();
+    }
+
+    bool empty() const {
+        std::lock_guard lock(m);
+        return st.empty();
+    }
+};